@@ -0,0 +1,302 @@
+// generates a synthetic header corpus of one shape and runs clcli over
+// it, recording wall time and peak RSS of the run.
+//
+// usage: clcli_corpus <clcli> <shape> <size> <dir> [max-rss-mb]
+//
+//   records     <size> records in one header, each embedding the previous
+//   namespaces  one record per namespace, nested <size> levels deep
+//   wide        one record with <size> fields
+//   includes    <size> headers included by the input, a few records each
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <fmt/format.h>
+
+static const char *kScalarTypes[] = {
+    "int",
+    "unsigned int",
+    "short",
+    "unsigned char",
+    "long long",
+    "float",
+    "double",
+    "_Bool",
+};
+
+static bool WriteFile(const std::string& path, const fmt::memory_buffer& contents)
+{
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f)
+    {
+        fmt::print(stderr, "{}: failed to write.\n", path);
+        return false;
+    }
+
+    fwrite(contents.data(), 1, contents.size(), f);
+    return !fclose(f);
+}
+
+static void DefineRecord(fmt::memory_buffer *out, const std::string& name, uint32_t seed, const std::string& nested)
+{
+    fmt::format_to(
+        std::back_inserter(*out),
+        "struct {}\n"
+        "{{\n"
+        "    {} id;\n"
+        "    unsigned int len;\n"
+        "    short values[8];\n"
+        "    {} score;\n",
+        name,
+        kScalarTypes[seed % 5],
+        kScalarTypes[5 + seed % 2]
+    );
+
+    if (!nested.empty())
+    {
+        fmt::format_to(
+            std::back_inserter(*out),
+            "    struct {} prev;\n",
+            nested
+        );
+    }
+
+    fmt::format_to(
+        std::back_inserter(*out),
+        "}};\n\n"
+    );
+}
+
+static bool GenerateRecords(const std::string& dir, uint32_t size)
+{
+    fmt::memory_buffer out;
+    for (uint32_t i = 0; i < size; ++ i)
+    {
+        DefineRecord(&out, fmt::format("Record{}", i), i, i ? fmt::format("Record{}", i - 1) : "");
+    }
+
+    return WriteFile(dir + "/corpus.h", out);
+}
+
+// exercises the namespace recursion of the visitor, needs c++.
+static bool GenerateNamespaces(const std::string& dir, uint32_t size)
+{
+    fmt::memory_buffer out;
+    for (uint32_t i = 0; i < size; ++ i)
+    {
+        fmt::format_to(std::back_inserter(out), "namespace n{}\n{{\n", i);
+        DefineRecord(&out, fmt::format("Level{}", i), i, "");
+    }
+
+    for (uint32_t i = 0; i < size; ++ i)
+    {
+        fmt::format_to(std::back_inserter(out), "}}\n");
+    }
+
+    return WriteFile(dir + "/corpus.h", out);
+}
+
+static bool GenerateWide(const std::string& dir, uint32_t size)
+{
+    fmt::memory_buffer out;
+    fmt::format_to(std::back_inserter(out), "struct Wide\n{{\n");
+
+    for (uint32_t i = 0; i < size; ++ i)
+    {
+        const char *type = kScalarTypes[i % 8];
+        switch (i % 11)
+        {
+            case 9:
+                fmt::format_to(std::back_inserter(out), "    {} f{}[4];\n", type, i);
+                break;
+            case 10:
+                fmt::format_to(std::back_inserter(out), "    unsigned int f{} : 3;\n", i);
+                break;
+            default:
+                fmt::format_to(std::back_inserter(out), "    {} f{};\n", type, i);
+                break;
+        }
+    }
+
+    fmt::format_to(std::back_inserter(out), "}};\n");
+    return WriteFile(dir + "/corpus.h", out);
+}
+
+// each header includes the previous one as well, so the closure is
+// both wide and deep.
+static bool GenerateIncludes(const std::string& dir, uint32_t size)
+{
+    fmt::memory_buffer input;
+
+    for (uint32_t i = 0; i < size; ++ i)
+    {
+        fmt::memory_buffer out;
+        fmt::format_to(
+            std::back_inserter(out),
+            "#ifndef CORPUS_{}_H\n"
+            "#define CORPUS_{}_H\n\n",
+            i,
+            i
+        );
+
+        if (i)
+        {
+            fmt::format_to(std::back_inserter(out), "#include \"corpus_{}.h\"\n\n", i - 1);
+        }
+
+        for (uint32_t j = 0; j < 4; ++ j)
+        {
+            DefineRecord(&out, fmt::format("Header{}Record{}", i, j), i + j, "");
+        }
+
+        fmt::format_to(std::back_inserter(out), "#endif\n");
+
+        if (!WriteFile(fmt::format("{}/corpus_{}.h", dir, i), out))
+        {
+            return false;
+        }
+
+        fmt::format_to(std::back_inserter(input), "#include \"corpus_{}.h\"\n", i);
+    }
+
+    return WriteFile(dir + "/corpus.h", input);
+}
+
+static double Now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5)
+    {
+        fmt::print(stderr, "usage: {} <clcli> <shape> <size> <dir> [max-rss-mb]\n", argv[0]);
+        return 2;
+    }
+
+    const std::string clcli = argv[1];
+    const std::string shape = argv[2];
+    const uint32_t size = strtoul(argv[3], nullptr, 10);
+    const std::string dir = argv[4];
+    const uint64_t maxRssKb = argc > 5 ? strtoull(argv[5], nullptr, 10) * 1024 : 0;
+
+    if (mkdir(dir.c_str(), 0755) && errno != EEXIST)
+    {
+        fmt::print(stderr, "{}: failed to create.\n", dir);
+        return 1;
+    }
+
+    bool generated = false;
+    if (shape == "records")
+    {
+        generated = GenerateRecords(dir, size);
+    }
+    else if (shape == "namespaces")
+    {
+        generated = GenerateNamespaces(dir, size);
+    }
+    else if (shape == "wide")
+    {
+        generated = GenerateWide(dir, size);
+    }
+    else if (shape == "includes")
+    {
+        generated = GenerateIncludes(dir, size);
+    }
+    else
+    {
+        fmt::print(stderr, "{}: unknown shape.\n", shape);
+        return 2;
+    }
+
+    if (!generated)
+    {
+        return 1;
+    }
+
+    // the per-phase timing of --stats goes to stderr, into the log of
+    // the benchmark run.
+    std::vector<const char *> args = {
+        clcli.c_str(),
+        "--codec",
+        "--stats",
+        "-C",
+        dir.c_str(),
+        "-n",
+        "corpus",
+    };
+
+    if (shape == "namespaces")
+    {
+        args.push_back("-s");
+        args.push_back("c++11");
+    }
+
+    args.push_back("corpus.h");
+    args.push_back(nullptr);
+
+    const double start = Now();
+
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        fmt::print(stderr, "failed to fork.\n");
+        return 1;
+    }
+
+    if (!pid)
+    {
+        execv(clcli.c_str(), const_cast<char **>(args.data()));
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0)
+    {
+        fmt::print(stderr, "failed to wait for {}.\n", clcli);
+        return 1;
+    }
+
+    const double wall = Now() - start;
+    const uint64_t rssKb = usage.ru_maxrss;
+
+    fmt::memory_buffer result;
+    fmt::format_to(
+        std::back_inserter(result),
+        "{{\"shape\": \"{}\", \"size\": {}, \"wall_ms\": {:.3f}, \"user_ms\": {:.3f}, \"max_rss_kb\": {}}}\n",
+        shape,
+        size,
+        wall * 1e3,
+        usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec * 1e-3,
+        rssKb
+    );
+
+    fwrite(result.data(), 1, result.size(), stdout);
+    WriteFile(dir + "/result.json", result);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status))
+    {
+        fmt::print(stderr, "{}: clcli failed.\n", shape);
+        return 1;
+    }
+
+    if (maxRssKb && rssKb > maxRssKb)
+    {
+        fmt::print(stderr, "{}: peak RSS {} KB over the {} KB budget.\n", shape, rssKb, maxRssKb);
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,92 +1,215 @@
+#include <map>
+#include <set>
 #include <vector>
 #include <string>
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <fmt/format.h>
-#include <boost/algorithm/string/predicate.hpp>
+#include <fmt/ranges.h>
 
 #include "builder.h"
+#include "fragment.h"
+#include "phash.h"
 #include "util.h"
+#include "profile.h"
 
-std::string StripPrefixDot(const std::string& path)
+struct BuilderV1 : public FragmentBuilder
 {
-    if (boost::algorithm::istarts_with(path, "./")
-        || boost::algorithm::istarts_with(path, ".\\"))
-    {
-        return {
-            path.data() + 2,
-            path.size() - 2
-        };
-    }
-    else
-    {
-        return path;
-    }
-}
-
-struct BuilderV1 : public Builder
-{
-    void EnterObject(CXCursor cursor) override;
+    void EnterObject(const IrRecord& record) override;
     void LeaveObject() override;
 
-    void DefineNumberField(CXCursor cursor) override;
-    void DefineArrayField(CXCursor cursor, CXCursor element) override;
-    void DefineObjectField(CXCursor cursor) override;
+    void DefineNumberField(const IrField& field) override;
+    void DefineArrayField(const IrField& field) override;
+    void DefineObjectField(const IrField& field) override;
+    void DefinePointerField(const IrField& field) override;
+    void DefineContainerField(const IrField& field) override;
 
-    void LineInfo(CXCursor cursor);
-    void DefineFixedArrayField(CXCursor cursor, CXCursor elementType);
-    void DefineFlexableArrayField(CXCursor cursor, CXCursor elementType);
-    void Include(std::string header) override;
+    void DefineFieldIndex(const FieldIndex& index);
+    void DefineFieldNames();
+    void DefineWireOrder();
+    void CloseColumnGroup(uint32_t columns, bool joinPrevious = false);
+    void WriteColumns();
+    void DefineCodec();
+    void DefineNumberColumn(const std::string& field, const std::string& kind, const IrField *hints = nullptr);
+    void FlushNumberRun();
+    void DefineBitfield(const IrField& field);
+    void FlushBitfieldRun();
+    void CodecStatement(const std::string& encode, const std::string& decode);
+    void CodecObjectLoop(const IrField& field, const std::string& lengthField);
+    void CodecLengthCheck(const std::string& lengthField);
+    void CodecSoaArray(const std::string& elementName, const std::string& lengthField);
+    void CodecContainerLoop(const IrField& field, const std::string& elementName);
+    bool HasContainers(const IrRecord& record) const;
+    void DefineSoaMembers(const IrRecord& record);
+    void DefineFingerprint(const IrRecord& record);
+    void DefineBench();
+    void BenchStatement(const std::string& statement);
+    void BenchFillNumbers(const std::string& field, NumberType type, bool isArray);
+    void BenchFillObjects(const IrField& field);
+    void BenchLength(const std::string& lengthField, uint32_t maxCount);
+    void DefineFixedArrayField(const IrField& field);
+    void DefineFlexableArrayField(const IrField& field, const std::string& lengthField);
+    void CodecMaxCount(const IrField& field, const std::string& lengthField);
 
-    std::string GetSource() override;
+    void WriteIncludes(fmt::memory_buffer *buffer) const;
+    void WriteSource(const SourceSink& sink, uint32_t shard, uint32_t shardCount) override;
     std::string GetSourceHeader() override;
+    std::string GetBenchSource() override;
+
+    uint32_t flags = 0;
+    bool codecNeedsIndex = false;
+    fmt::memory_buffer encodeBuffer;
+    fmt::memory_buffer decodeBuffer;
+
+    bool benchNeedsIndex = false;
+    fmt::memory_buffer fillBuffer;
+
+    // adjacent, padding-free scalars of one kind, offsets in bits.
+    std::vector<std::string> runFields;
+    NumberType runType;
+    long long runEnd = 0;
+
+    // adjacent bitfields packed into the same storage unit.
+    struct BitfieldColumn
+    {
+        std::string name;
+        std::string kind;
+        uint32_t bitOffset;
+        uint32_t width;
+    };
+
+    std::vector<BitfieldColumn> bitfieldRun;
+    uint64_t bitfieldUnitOffset = 0;
+    uint32_t bitfieldUnitSize = 0;
+
+    // the record between EnterObject() and LeaveObject(), and the
+    // fingerprints of the records emitted so far, by name.
+    const IrRecord *currentRecord = nullptr;
+    std::map<std::string, uint64_t> fingerprints;
 
-    std::string currentObjectType;
-    std::string currentObjectDisplayName;
+    // records holding a std container, directly or in a member record.
+    // they need constructors, so the calloc'd bench values leave them out.
+    std::set<std::string> containerRecords;
 
-    bool isUnion;
-    bool inObject;
-    fmt::memory_buffer sourceBuffer;
-    fmt::memory_buffer headerBuffer;
+    // columns are buffered in groups that stay together, a number block,
+    // a bitfield unit or a flexible array and its length, so a profile
+    // can move them as a whole.
+    struct ColumnGroup
+    {
+        size_t begin;
+        size_t end;
+        uint32_t firstColumn;
+        uint32_t columnCount;
+    };
 
-    bool prevFieldIsNumber;
-    std::string prevFieldDisplayName;
+    const FieldProfile *profile = nullptr;
+    fmt::memory_buffer columnsBuffer;
+    std::vector<ColumnGroup> columnGroups;
+    uint32_t groupedColumns = 0;
 
-    std::vector<std::string> includedFiles;
+    // the declaration index of each column when the profile reordered
+    // them, with the accessed ones first.
+    std::vector<uint32_t> wireOrder;
+    uint32_t hotColumns = 0;
 };
 
-void BuilderV1::EnterObject(CXCursor cursor)
+static const char *GetEncodingName(IrEncoding encoding)
 {
-    assert(!inObject);
+    switch (encoding)
+    {
+        case IrEncoding_Varint:
+            return "CL_ENCODING_VARINT";
+        case IrEncoding_Zigzag:
+            return "CL_ENCODING_ZIGZAG";
+        case IrEncoding_Fixed:
+            return "CL_ENCODING_FIXED";
+        case IrEncoding_Delta:
+            return "CL_ENCODING_DELTA";
+        default:
+            return "CL_ENCODING_DEFAULT";
+    }
+}
 
-    CXType type = clang_getCursorType(cursor);
-    CXCursor elementType = clang_getTypeDeclaration(
-        clang_getCanonicalType(type));
+// annotated fields use the _HINTED variant of their column and codec
+// macros, which take the encoding and the capacity as two more
+// arguments.
+static bool HasHints(const IrField& field)
+{
+    return field.encoding != IrEncoding_Default || field.maxCount;
+}
 
-    inObject = true;
-    isUnion = elementType.kind == CXCursor_UnionDecl;
-    currentObjectType = GetTypeSpelling(type);
-    currentObjectDisplayName = GetCursorDisplayName(cursor);
+static std::string HintSuffix(const IrField& field)
+{
+    return HasHints(field) ? "_HINTED" : "";
+}
 
-    prevFieldIsNumber = false;
-    prevFieldDisplayName.clear();
-    
-    fmt::format_to(
-        std::back_inserter(sourceBuffer),
-        "\n"
-    );
-    
-    LineInfo(cursor);
+static std::string HintArgs(const IrField& field)
+{
+    if (!HasHints(field))
+    {
+        return {};
+    }
+
+    return fmt::format(", {}, {}", GetEncodingName(field.encoding), field.maxCount);
+}
+
+void BuilderV1::EnterObject(const IrRecord& record)
+{
+    BeginObject(record);
+    LineInfo(record.location, &sourceBuffer);
+
+    codecNeedsIndex = false;
+    encodeBuffer.clear();
+    decodeBuffer.clear();
+
+    benchNeedsIndex = false;
+    fillBuffer.clear();
 
+    currentRecord = &record;
+
+    columnsBuffer.clear();
+    columnGroups.clear();
+    groupedColumns = 0;
+    wireOrder.clear();
+    hotColumns = 0;
+
+    // union columns are referenced by name from the records holding
+    // them, see IsInShard.
     fmt::format_to(
         std::back_inserter(sourceBuffer),
-        "static const clColumn {}Columns[] = {{\n",
+        "{}const clColumn {}Columns[] = {{\n",
+        isUnion ? "" : "static ",
         currentObjectDisplayName
     );
 }
 
+bool BuilderV1::HasContainers(const IrRecord& record) const
+{
+    for (auto field = record.fields; field; field = field->next)
+    {
+        if (field->kind == IrFieldKind_Container
+            || ((field->kind == IrFieldKind_Object || field->kind == IrFieldKind_Array)
+                && containerRecords.count(field->elementName ? field->elementName : "")))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void BuilderV1::LeaveObject()
 {
     assert(inObject);
+    FlushNumberRun();
+    WriteColumns();
+
+    const bool hasContainers = HasContainers(*currentRecord);
+    if (hasContainers)
+    {
+        containerRecords.insert(currentRecord->name);
+    }
     
     fmt::format_to(
         std::back_inserter(sourceBuffer),
@@ -95,18 +218,65 @@ void BuilderV1::LeaveObject()
     
     if (!isUnion)
     {
+        // the field index is left out where no perfect hash exists,
+        // e.g. a base class field shadowed by one of the same name.
+        FieldIndex index;
+        const bool hasIndex = BuildFieldIndex(currentFieldNames, &index);
+
+        if (hasIndex)
+        {
+            DefineFieldIndex(index);
+        }
+
+        // the optional tables each add a suffix to the object macro and
+        // their arguments after the columns and the field index.
+        std::string suffix;
+        std::string extraArgs;
+
+        if (!currentFieldNames.empty())
+        {
+            DefineFieldNames();
+            suffix += "_NAMED";
+            extraArgs += fmt::format(", clNames, {}Names", currentObjectDisplayName);
+        }
+
+        if (!wireOrder.empty())
+        {
+            DefineWireOrder();
+            suffix += "_ORDERED";
+            extraArgs += fmt::format(", {}WireOrder, {}", currentObjectDisplayName, hotColumns);
+        }
+
         fmt::format_to(
             std::back_inserter(sourceBuffer),
             "const clColumn {}Object[] = {{\n",
             currentObjectDisplayName
         );
-        
-        fmt::format_to(
-            std::back_inserter(sourceBuffer),
-            "    DEFINE_OBJECT({}, {}Columns),\n",
-            currentObjectType,
-            currentObjectDisplayName
-        );
+
+        if (hasIndex)
+        {
+            fmt::format_to(
+                std::back_inserter(sourceBuffer),
+                "    DEFINE_OBJECT_INDEXED{}({}, {}Columns, {}FieldSeeds, {}FieldSlots{}),\n",
+                suffix,
+                currentObjectType,
+                currentObjectDisplayName,
+                currentObjectDisplayName,
+                currentObjectDisplayName,
+                extraArgs
+            );
+        }
+        else
+        {
+            fmt::format_to(
+                std::back_inserter(sourceBuffer),
+                "    DEFINE_OBJECT{}({}, {}Columns{}),\n",
+                suffix,
+                currentObjectType,
+                currentObjectDisplayName,
+                extraArgs
+            );
+        }
         
         fmt::format_to(
             std::back_inserter(sourceBuffer),
@@ -118,246 +288,1609 @@ void BuilderV1::LeaveObject()
             "extern const struct clColumn {}Object[];\n",
             currentObjectDisplayName
         );
+
+        if ((flags & BuilderFlag_Soa) && currentRecord->isFlat)
+        {
+            DefineSoaMembers(*currentRecord);
+        }
+
+        if (flags & BuilderFlag_Codec)
+        {
+            DefineCodec();
+        }
+
+        if ((flags & BuilderFlag_Bench) && !hasContainers)
+        {
+            DefineBench();
+        }
+    }
+    else
+    {
+        fmt::format_to(
+            std::back_inserter(headerBuffer),
+            "extern const struct clColumn {}Columns[];\n",
+            currentObjectDisplayName
+        );
     }
 
-    inObject = false;
-    isUnion = false;
-    currentObjectType.clear();
-    currentObjectDisplayName.clear();
-    prevFieldIsNumber = false;
-    prevFieldDisplayName.clear();
+    DefineFingerprint(*currentRecord);
+    currentRecord = nullptr;
+
+    EndObject();
 }
 
-void BuilderV1::DefineNumberField(CXCursor cursor)
+// hashes the canonical text of the record, so the value does not depend
+// on the host byte order. a nested record contributes its fingerprint,
+// or its name when it was not emitted before, e.g. a pointer to the
+// record itself.
+void BuilderV1::DefineFingerprint(const IrRecord& record)
 {
-    prevFieldIsNumber = true;
-    prevFieldDisplayName = GetCursorDisplayName(cursor);
-
+    fmt::memory_buffer canonical;
     fmt::format_to(
-        std::back_inserter(sourceBuffer),
-        "    DEFINE_COLUMN_NUMBER({}, {}),\n",
-        currentObjectType,
-        prevFieldDisplayName
+        std::back_inserter(canonical),
+        "{} {} {} {}\n",
+        record.isUnion ? "union" : "struct",
+        record.name,
+        record.size,
+        record.align
     );
-}
-
-void BuilderV1::DefineArrayField(CXCursor cursor, CXCursor elementType)
-{
-    bool isFixedArray = true;
-    static const char *keywordStr[] = {
-        "len",
-        "num",
-        "size",
-    };
 
-    if (prevFieldIsNumber)
+    for (auto field = record.fields; field; field = field->next)
     {
-        for (const auto kw : keywordStr)
+        std::string element;
+        if (field->elementName)
         {
-            if (boost::algorithm::iends_with(
-                prevFieldDisplayName,
-                kw))
-            {
-                isFixedArray = false;
-            }
+            auto it = fingerprints.find(field->elementName);
+            element = it != fingerprints.end()
+                ? fmt::format("{:016x}", it->second)
+                : field->elementName;
         }
-    }
 
-    if (isFixedArray)
-    {
-        DefineFixedArrayField(cursor, elementType);
-    }
-    else
-    {
-        DefineFlexableArrayField(cursor, elementType);
+        // a std::array and a std::vector may share size and element.
+        std::string kind = fmt::format("{}", static_cast<int>(field->kind));
+        if (field->kind == IrFieldKind_Container)
+        {
+            kind += fmt::format(".{}", static_cast<int>(field->container));
+        }
+
+        fmt::format_to(
+            std::back_inserter(canonical),
+            "{} {} {} {} {} {} {} {} {} {} {} {}\n",
+            field->name,
+            kind,
+            field->offset,
+            field->size,
+            field->bitWidth,
+            GetNumberTypeName(field->number),
+            field->isDirect ? 1 : 0,
+            field->pointeeIsChar ? 1 : 0,
+            static_cast<int>(field->encoding),
+            field->maxCount,
+            field->lengthField ? field->lengthField : "-",
+            element.empty() ? "-" : element
+        );
     }
+
+    const uint64_t fingerprint = HashBytes(canonical.data(), canonical.size());
+    fingerprints[record.name] = fingerprint;
+
+    // the macro lets a peer compare at compile time, e.g. in a
+    // static_assert or #if, without linking the generated source.
+    fmt::format_to(
+        std::back_inserter(sourceBuffer),
+        "const unsigned long long {}Fingerprint = {}_FINGERPRINT;\n",
+        currentObjectDisplayName,
+        currentObjectDisplayName
+    );
+
+    fmt::format_to(
+        std::back_inserter(headerBuffer),
+        "#define {}_FINGERPRINT 0x{:016x}ull\n"
+        "extern const unsigned long long {}Fingerprint;\n",
+        currentObjectDisplayName,
+        fingerprint,
+        currentObjectDisplayName
+    );
 }
 
-void BuilderV1::DefineFixedArrayField(CXCursor cursor, CXCursor elementType)
+// the transposed layout of a flat record: the offset and kind of each
+// member, with the record size as the stride. arrays of the record refer
+// to it by name, see IsInShard.
+void BuilderV1::DefineSoaMembers(const IrRecord& record)
 {
-    assert(inObject);
-    prevFieldIsNumber = false;
-    prevFieldDisplayName = GetCursorDisplayName(cursor);
+    fmt::format_to(
+        std::back_inserter(sourceBuffer),
+        "const clSoaMember {}Members[] = {{\n",
+        currentObjectDisplayName
+    );
 
-    if (elementType.kind != CXCursor_NoDeclFound)
+    for (auto field = record.fields; field; field = field->next)
     {
         fmt::format_to(
             std::back_inserter(sourceBuffer),
-            "    DEFINE_COLUMN_OBJECT_FIXED_ARRAY({}, {}, {}Object),\n",
+            "    DEFINE_SOA_MEMBER({}, {}, {}),\n",
             currentObjectType,
-            prevFieldDisplayName,
-            GetCursorDisplayName(elementType)
+            field->name,
+            GetNumberTypeName(field->number)
         );
     }
-    else
+
+    fmt::format_to(
+        std::back_inserter(sourceBuffer),
+        "    DEFINE_SOA_MEMBER_END({}),\n"
+        "}};\n",
+        currentObjectType
+    );
+
+    fmt::format_to(
+        std::back_inserter(headerBuffer),
+        "extern const struct clSoaMember {}Members[];\n",
+        currentObjectDisplayName
+    );
+}
+
+void BuilderV1::CloseColumnGroup(uint32_t columns, bool joinPrevious)
+{
+    if (joinPrevious && !columnGroups.empty())
     {
-        fmt::format_to(
-            std::back_inserter(sourceBuffer),
-            "    DEFINE_COLUMN_FIXED_ARRAY({}, {}),\n",
-            currentObjectType,
-            prevFieldDisplayName
-        );
+        auto& previous = columnGroups.back();
+        previous.end = columnsBuffer.size();
+        previous.columnCount += columns;
+        groupedColumns += columns;
+        return;
     }
+
+    ColumnGroup group;
+    group.begin = columnGroups.empty() ? 0 : columnGroups.back().end;
+    group.end = columnsBuffer.size();
+    group.firstColumn = groupedColumns;
+    group.columnCount = columns;
+
+    columnGroups.push_back(group);
+    groupedColumns += columns;
 }
 
-void BuilderV1::DefineFlexableArrayField(CXCursor cursor, CXCursor elementType)
+// without a profile for the record the columns keep declaration order.
+// otherwise the groups holding accessed fields go first, the hottest
+// first, and the wire order table maps each column back to the
+// declaration index the wire format is keyed by. the codec functions
+// never change order.
+void BuilderV1::WriteColumns()
 {
-    assert(inObject);
-    prevFieldIsNumber = false;
-    prevFieldDisplayName = GetCursorDisplayName(cursor);
-    
-    if (elementType.kind != CXCursor_NoDeclFound)
+    std::vector<uint64_t> counts(columnGroups.size());
+    bool isProfiled = false;
+
+    for (size_t i = 0; profile && !isUnion && i < columnGroups.size(); ++ i)
     {
-        fmt::format_to(
-            std::back_inserter(sourceBuffer),
-            "    DEFINE_COLUMN_OBJECT_FLEXIBLE_ARRAY({}, {}, {}Object),\n",
-            currentObjectType,
-            prevFieldDisplayName,
-            GetCursorDisplayName(elementType)
-        );
+        const auto& group = columnGroups[i];
+        for (uint32_t j = 0; j < group.columnCount; ++ j)
+        {
+            const auto& name = currentFieldNames[group.firstColumn + j];
+            counts[i] = std::max(counts[i], GetFieldCount(*profile, currentObjectDisplayName, name));
+        }
+
+        isProfiled = isProfiled || counts[i];
     }
-    else
+
+    if (!isProfiled)
     {
-        fmt::format_to(
-            std::back_inserter(sourceBuffer),
-            "    DEFINE_COLUMN_FLEXIBLE_ARRAY({}, {}),\n",
-            currentObjectType,
-            prevFieldDisplayName
-        );
+        sourceBuffer.append(columnsBuffer.data(), columnsBuffer.data() + columnsBuffer.size());
+        return;
+    }
+
+    std::vector<size_t> order(columnGroups.size());
+    for (size_t i = 0; i < order.size(); ++ i)
+    {
+        order[i] = i;
+    }
+
+    std::stable_sort(
+        order.begin(),
+        order.end(),
+        [&counts](size_t a, size_t b) {
+            return counts[a] > counts[b];
+        }
+    );
+
+    std::vector<std::string> names;
+    for (const auto i : order)
+    {
+        const auto& group = columnGroups[i];
+        sourceBuffer.append(columnsBuffer.data() + group.begin, columnsBuffer.data() + group.end);
+
+        for (uint32_t j = 0; j < group.columnCount; ++ j)
+        {
+            wireOrder.push_back(group.firstColumn + j);
+            names.push_back(currentFieldNames[group.firstColumn + j]);
+        }
+
+        if (counts[i])
+        {
+            hotColumns += group.columnCount;
+        }
     }
+
+    // the field index and the name table follow the table order.
+    currentFieldNames = std::move(names);
 }
 
-void BuilderV1::DefineObjectField(CXCursor cursor)
+void BuilderV1::DefineWireOrder()
 {
-    assert(inObject);
-    prevFieldIsNumber = false;
-    prevFieldDisplayName = GetCursorDisplayName(cursor);
-    
-    CXType type = clang_getCursorType(cursor);
-    CXCursor elementType = clang_getTypeDeclaration(
-        clang_getCanonicalType(type));
-    
-    if (elementType.kind != CXCursor_UnionDecl)
+    fmt::format_to(
+        std::back_inserter(sourceBuffer),
+        "static const unsigned short {}WireOrder[] = {{\n",
+        currentObjectDisplayName
+    );
+
+    for (size_t i = 0; i < wireOrder.size(); i += 8)
     {
+        const size_t end = std::min(i + 8, wireOrder.size());
         fmt::format_to(
             std::back_inserter(sourceBuffer),
-            "    DEFINE_COLUMN_OBJECT({}, {}, {}Object),\n",
-            currentObjectType,
-            prevFieldDisplayName,
-            GetCursorDisplayName(elementType)
+            "    {},\n",
+            fmt::join(wireOrder.begin() + i, wireOrder.begin() + end, ", ")
         );
     }
-    else
-    {
-        CXType type = clang_getCursorType(cursor);
-        CXCursor elementType = clang_getTypeDeclaration(
-            clang_getCanonicalType(type));
 
+    fmt::format_to(
+        std::back_inserter(sourceBuffer),
+        "}};\n"
+    );
+}
+
+// one offset/length pair per column into the name pool of the output
+// file, the clName_ offsets are defined by WriteSource once every
+// record of the file is known.
+void BuilderV1::DefineFieldNames()
+{
+    fmt::format_to(
+        std::back_inserter(sourceBuffer),
+        "static const clName {}Names[] = {{\n",
+        currentObjectDisplayName
+    );
+
+    for (const auto& name : currentFieldNames)
+    {
         fmt::format_to(
             std::back_inserter(sourceBuffer),
-            "    DEFINE_COLUMN_UNION({}, {}, {}Columns),\n",
-            currentObjectType,
-            prevFieldDisplayName,
-            GetCursorDisplayName(elementType)
+            "    {{clName_{}, {}}},\n",
+            name,
+            name.size()
         );
     }
-}
-    
-void BuilderV1::LineInfo(CXCursor cursor)
-{
-    CXSourceLocation location = clang_getCursorLocation(cursor);
-    
-    CXString name;
-    unsigned int line = 0, column = 0;
-    clang_getPresumedLocation(location, &name, &line, &column);
 
     fmt::format_to(
         std::back_inserter(sourceBuffer),
-        "// line {}:{}:{}\n",
-        StripPrefixDot(clang_getCString(name)),
-        line,
-        column
+        "}};\n"
     );
-    
-    clang_disposeString(name);
+
+    pooledNames = currentFieldNames;
 }
 
-void BuilderV1::Include(std::string name)
+void BuilderV1::DefineFieldIndex(const FieldIndex& index)
 {
-    includedFiles.push_back(
-        StripPrefixDot(name)
+    fmt::format_to(
+        std::back_inserter(sourceBuffer),
+        "static const unsigned int {}FieldSeeds[] = {{\n",
+        currentObjectDisplayName
     );
-}
 
-std::string BuilderV1::GetSource()
-{
-    fmt::memory_buffer source;
+    for (size_t i = 0; i < index.seeds.size(); i += 8)
+    {
+        const size_t end = std::min(i + 8, index.seeds.size());
+        fmt::format_to(
+            std::back_inserter(sourceBuffer),
+            "    {},\n",
+            fmt::join(index.seeds.begin() + i, index.seeds.begin() + end, ", ")
+        );
+    }
+
     fmt::format_to(
-        std::back_inserter(source),
-        "// generated by the clcli. DO NOT EDIT!\n\n"
+        std::back_inserter(sourceBuffer),
+        "}};\n"
     );
 
     fmt::format_to(
-        std::back_inserter(source),
-        "#include <columns.h>\n"
+        std::back_inserter(sourceBuffer),
+        "static const unsigned short {}FieldSlots[] = {{\n",
+        currentObjectDisplayName
     );
 
-    for (const auto& includedFile : includedFiles)
+    for (size_t i = 0; i < index.slots.size(); i += 8)
     {
+        const size_t end = std::min(i + 8, index.slots.size());
         fmt::format_to(
-            std::back_inserter(source),
-            "\n#include \"{}\"",
-            includedFile
+            std::back_inserter(sourceBuffer),
+            "    {},\n",
+            fmt::join(index.slots.begin() + i, index.slots.begin() + end, ", ")
         );
     }
-    
+
     fmt::format_to(
-        std::back_inserter(source),
-        "\n{:.{}}", 
-        sourceBuffer.data(), 
-        sourceBuffer.size()
+        std::back_inserter(sourceBuffer),
+        "}};\n"
     );
-
-    return {
-        source.data(),
-        source.size(),
-    };
 }
 
-std::string BuilderV1::GetSourceHeader()
+void BuilderV1::DefineNumberField(const IrField& field)
 {
-    fmt::memory_buffer sourceHeader;
-    fmt::format_to(
-        std::back_inserter(sourceHeader),
-        "// generated by the clcli. DO NOT EDIT!\n\n"
-    );
+    BeginField(field, true);
 
-    fmt::format_to(
-        std::back_inserter(sourceHeader),
-        "#pragma once\n\n"
+    const NumberType type = field.number;
+    const long long offset = field.offset;
+    const long long size = type.size;
+
+    if (field.isBitField)
+    {
+        DefineBitfield(field);
+        return;
+    }
+
+    BenchFillNumbers(prevFieldDisplayName, type, false);
+
+    // fields of a base class are laid out relative to the base, so they
+    // cannot join a block, nor can fields with their own encoding.
+    const bool isBlockable = offset >= 0
+        && (size == 1 || size == 2 || size == 4 || size == 8)
+        && field.isDirect
+        && !HasHints(field);
+
+    if (!isBlockable
+        || runFields.empty()
+        || type.kind != runType.kind
+        || type.isEnum != runType.isEnum
+        || type.size != runType.size
+        || offset != runEnd)
+    {
+        FlushNumberRun();
+    }
+
+    if (!isBlockable)
+    {
+        DefineNumberColumn(prevFieldDisplayName, GetNumberTypeName(type), &field);
+        return;
+    }
+
+    runFields.push_back(prevFieldDisplayName);
+    runType = type;
+    runEnd = offset + size * 8;
+}
+
+void BuilderV1::DefineNumberColumn(const std::string& field, const std::string& kind, const IrField *hints)
+{
+    const auto suffix = hints ? HintSuffix(*hints) : std::string();
+    const auto hintArgs = hints ? HintArgs(*hints) : std::string();
+
+    fmt::format_to(
+        std::back_inserter(columnsBuffer),
+        "    DEFINE_COLUMN_NUMBER{}({}, {}, {}{}),\n",
+        suffix,
+        currentObjectType,
+        field,
+        kind,
+        hintArgs
+    );
+
+    CodecStatement(
+        fmt::format("CL_ENCODE_NUMBER{}(writer, value->{}, {}{})", suffix, field, kind, hintArgs),
+        fmt::format("CL_DECODE_NUMBER{}(reader, value->{}, {}{})", suffix, field, kind, hintArgs)
+    );
+
+    CloseColumnGroup(1);
+}
+
+void BuilderV1::DefineBitfield(const IrField& field)
+{
+    const auto kind = GetNumberTypeName(field.number);
+
+    uint64_t unitOffset;
+    uint32_t unitSize;
+    GetBitfieldUnit(field, &unitOffset, &unitSize);
+
+    if (bitfieldRun.empty()
+        || unitOffset != bitfieldUnitOffset
+        || unitSize != bitfieldUnitSize)
+    {
+        FlushNumberRun();
+    }
+
+    BitfieldColumn column;
+    column.name = prevFieldDisplayName;
+    column.kind = kind;
+    column.bitOffset = field.offset - unitOffset * 8;
+    column.width = field.bitWidth;
+
+    bitfieldRun.push_back(column);
+    bitfieldUnitOffset = unitOffset;
+    bitfieldUnitSize = unitSize;
+
+    CodecStatement(
+        fmt::format("CL_ENCODE_BITFIELD(writer, value->{}, {}, {})", column.name, column.width, kind),
+        fmt::format("CL_DECODE_BITFIELD(reader, value->{}, {}, {})", column.name, column.width, kind)
+    );
+
+    // assignment truncates the value to the width.
+    BenchStatement(
+        fmt::format("value->{} = clBenchRandom(seed);", column.name)
+    );
+}
+
+void BuilderV1::FlushBitfieldRun()
+{
+    // like the number blocks, the group column lets a runtime read the
+    // storage unit once for every bitfield in it, the member columns
+    // keep one column per field.
+    for (size_t i = 0; i < bitfieldRun.size(); ++ i)
+    {
+        const auto& column = bitfieldRun[i];
+
+        if (bitfieldRun.size() == 1)
+        {
+            fmt::format_to(
+                std::back_inserter(columnsBuffer),
+                "    DEFINE_COLUMN_BITFIELD({}, {}, {}, {}, {}, {}, {}),\n",
+                currentObjectType,
+                column.name,
+                column.kind,
+                bitfieldUnitOffset,
+                bitfieldUnitSize,
+                column.bitOffset,
+                column.width
+            );
+        }
+        else if (!i)
+        {
+            fmt::format_to(
+                std::back_inserter(columnsBuffer),
+                "    DEFINE_COLUMN_BITFIELD_GROUP({}, {}, {}, {}, {}, {}, {}, {}),\n",
+                currentObjectType,
+                column.name,
+                column.kind,
+                bitfieldUnitOffset,
+                bitfieldUnitSize,
+                column.bitOffset,
+                column.width,
+                bitfieldRun.size()
+            );
+        }
+        else
+        {
+            fmt::format_to(
+                std::back_inserter(columnsBuffer),
+                "    DEFINE_COLUMN_BITFIELD_MEMBER({}, {}, {}, {}, {}, {}, {}),\n",
+                currentObjectType,
+                column.name,
+                column.kind,
+                bitfieldUnitOffset,
+                bitfieldUnitSize,
+                column.bitOffset,
+                column.width
+            );
+        }
+    }
+
+    if (!bitfieldRun.empty())
+    {
+        CloseColumnGroup(bitfieldRun.size());
+    }
+
+    bitfieldRun.clear();
+    bitfieldUnitOffset = 0;
+    bitfieldUnitSize = 0;
+}
+
+void BuilderV1::FlushNumberRun()
+{
+    FlushBitfieldRun();
+
+    const auto kind = GetNumberTypeName(runType);
+
+    if (runFields.size() == 1)
+    {
+        DefineNumberColumn(runFields.front(), kind);
+    }
+    else if (runFields.size() > 1)
+    {
+        // the block column covers the whole run, the member columns
+        // keep one column per field for name lookups and are skipped
+        // by a runtime that already handled the block.
+        fmt::format_to(
+            std::back_inserter(columnsBuffer),
+            "    DEFINE_COLUMN_NUMBER_BLOCK({}, {}, {}, {}),\n",
+            currentObjectType,
+            runFields.front(),
+            runFields.size(),
+            kind
+        );
+
+        for (size_t i = 1; i < runFields.size(); ++ i)
+        {
+            fmt::format_to(
+                std::back_inserter(columnsBuffer),
+                "    DEFINE_COLUMN_NUMBER_BLOCK_MEMBER({}, {}),\n",
+                currentObjectType,
+                runFields[i]
+            );
+        }
+
+        CloseColumnGroup(runFields.size());
+
+        CodecStatement(
+            fmt::format("CL_ENCODE_NUMBER_BLOCK(writer, &value->{}, {}, {})", runFields.front(), runFields.size(), kind),
+            fmt::format("CL_DECODE_NUMBER_BLOCK(reader, &value->{}, {}, {})", runFields.front(), runFields.size(), kind)
+        );
+    }
+
+    runFields.clear();
+    runType = NumberType();
+    runEnd = 0;
+}
+
+void BuilderV1::DefineArrayField(const IrField& field)
+{
+    FlushNumberRun();
+
+    const auto lengthField = GetLengthField(field);
+    if (!lengthField.empty())
+    {
+        DefineFlexableArrayField(field, lengthField);
+    }
+    else
+    {
+        DefineFixedArrayField(field);
+    }
+}
+
+void BuilderV1::DefineFixedArrayField(const IrField& field)
+{
+    const NumberType numberType = field.number;
+    BeginField(field, false);
+
+    if (field.elementName)
+    {
+        const std::string elementName = field.elementName;
+
+        if ((flags & BuilderFlag_Soa) && field.elementIsFlat)
+        {
+            fmt::format_to(
+                std::back_inserter(columnsBuffer),
+                "    DEFINE_COLUMN_OBJECT_FIXED_ARRAY_SOA({}, {}, {}Object, {}Members),\n",
+                currentObjectType,
+                prevFieldDisplayName,
+                elementName,
+                elementName
+            );
+
+            CodecSoaArray(elementName, {});
+        }
+        else
+        {
+            fmt::format_to(
+                std::back_inserter(columnsBuffer),
+                "    DEFINE_COLUMN_{}_FIXED_ARRAY({}, {}, {}{}),\n",
+                field.elementIsUnion ? "UNION" : "OBJECT",
+                currentObjectType,
+                prevFieldDisplayName,
+                elementName,
+                field.elementIsUnion ? "Columns" : "Object"
+            );
+
+            CodecObjectLoop(field, {});
+        }
+
+        BenchFillObjects(field);
+    }
+    else
+    {
+        const auto kind = GetNumberTypeName(numberType);
+        const auto suffix = HintSuffix(field);
+        const auto hintArgs = HintArgs(field);
+
+        fmt::format_to(
+            std::back_inserter(columnsBuffer),
+            "    DEFINE_COLUMN_FIXED_ARRAY{}({}, {}, {}{}),\n",
+            suffix,
+            currentObjectType,
+            prevFieldDisplayName,
+            kind,
+            hintArgs
+        );
+
+        CodecStatement(
+            fmt::format("CL_ENCODE_FIXED_ARRAY{}(writer, value->{}, {}{})", suffix, prevFieldDisplayName, kind, hintArgs),
+            fmt::format("CL_DECODE_FIXED_ARRAY{}(reader, value->{}, {}{})", suffix, prevFieldDisplayName, kind, hintArgs)
+        );
+
+        BenchFillNumbers(prevFieldDisplayName, numberType, true);
+    }
+
+    CloseColumnGroup(1);
+}
+
+void BuilderV1::DefineFlexableArrayField(const IrField& field, const std::string& lengthField)
+{
+    const NumberType numberType = field.number;
+    BeginField(field, false);
+
+    // an annotated length need not be the previous field, so the counted
+    // columns name it.
+    const char *column = field.lengthField ? "COUNTED_ARRAY" : "FLEXIBLE_ARRAY";
+    const auto lengthArg = field.lengthField ? fmt::format(", {}", lengthField) : std::string();
+    const auto suffix = HintSuffix(field);
+    const auto hintArgs = HintArgs(field);
+
+    CodecMaxCount(field, lengthField);
+
+    if (field.elementName)
+    {
+        const std::string elementName = field.elementName;
+        const bool isSoa = (flags & BuilderFlag_Soa) && field.elementIsFlat;
+
+        fmt::format_to(
+            std::back_inserter(columnsBuffer),
+            "    DEFINE_COLUMN_{}_{}{}{}({}, {}{}, {}{}{}{}),\n",
+            field.elementIsUnion ? "UNION" : "OBJECT",
+            column,
+            isSoa ? "_SOA" : "",
+            suffix,
+            currentObjectType,
+            prevFieldDisplayName,
+            lengthArg,
+            elementName,
+            field.elementIsUnion ? "Columns" : "Object",
+            isSoa ? fmt::format(", {}Members", elementName) : std::string(),
+            hintArgs
+        );
+
+        if (isSoa)
+        {
+            CodecSoaArray(elementName, lengthField);
+        }
+        else
+        {
+            CodecObjectLoop(field, lengthField);
+        }
+        BenchFillObjects(field);
+        BenchLength(lengthField, field.maxCount);
+    }
+    else
+    {
+        const auto kind = GetNumberTypeName(numberType);
+
+        fmt::format_to(
+            std::back_inserter(columnsBuffer),
+            "    DEFINE_COLUMN_{}{}({}, {}{}, {}{}),\n",
+            column,
+            suffix,
+            currentObjectType,
+            prevFieldDisplayName,
+            lengthArg,
+            kind,
+            hintArgs
+        );
+
+        CodecStatement(
+            fmt::format("CL_ENCODE_FLEXIBLE_ARRAY{}(writer, value->{}, value->{}, {}{})", suffix, prevFieldDisplayName, lengthField, kind, hintArgs),
+            fmt::format("CL_DECODE_FLEXIBLE_ARRAY{}(reader, value->{}, value->{}, {}{})", suffix, prevFieldDisplayName, lengthField, kind, hintArgs)
+        );
+
+        BenchFillNumbers(prevFieldDisplayName, numberType, true);
+        BenchLength(lengthField, field.maxCount);
+    }
+
+    // the flexible columns take their length from the previous column,
+    // which closed the last group, so a reorder must not split them.
+    CloseColumnGroup(1, !field.lengthField);
+}
+
+void BuilderV1::DefineObjectField(const IrField& field)
+{
+    FlushNumberRun();
+    BeginField(field, false);
+    
+    const std::string elementName = field.elementName;
+    
+    if (!field.elementIsUnion)
+    {
+        fmt::format_to(
+            std::back_inserter(columnsBuffer),
+            "    DEFINE_COLUMN_OBJECT({}, {}, {}Object),\n",
+            currentObjectType,
+            prevFieldDisplayName,
+            elementName
+        );
+
+        CodecStatement(
+            fmt::format("encode_{}(writer, &value->{})", elementName, prevFieldDisplayName),
+            fmt::format("decode_{}(reader, &value->{})", elementName, prevFieldDisplayName)
+        );
+
+        BenchStatement(
+            fmt::format("fill_{}(&value->{}, seed);", elementName, prevFieldDisplayName)
+        );
+    }
+    else
+    {
+        fmt::format_to(
+            std::back_inserter(columnsBuffer),
+            "    DEFINE_COLUMN_UNION({}, {}, {}Columns),\n",
+            currentObjectType,
+            prevFieldDisplayName,
+            elementName
+        );
+
+        // a union has no selector to branch on, it stays table driven.
+        CodecStatement(
+            fmt::format("CL_ENCODE_UNION(writer, value->{}, {}Columns)", prevFieldDisplayName, elementName),
+            fmt::format("CL_DECODE_UNION(reader, value->{}, {}Columns)", prevFieldDisplayName, elementName)
+        );
+    }
+
+    CloseColumnGroup(1);
+}
+
+void BuilderV1::DefinePointerField(const IrField& field)
+{
+    FlushNumberRun();
+
+    // a pointer is only an array when annotated, a size field in front
+    // of e.g. a name says nothing about the string.
+    const std::string lengthField = field.lengthField ? field.lengthField : "";
+    const bool hasLength = !lengthField.empty();
+    BeginField(field, false);
+
+    // strings and scalar arrays decode as views into the input buffer,
+    // which has to outlive the decoded value. records are decoded into
+    // storage owned by the runtime.
+    std::string column;
+    std::string columnArgs;
+    std::string codecArgs;
+
+    if (field.elementName)
+    {
+        const std::string elementName = field.elementName;
+
+        column = hasLength ? "OBJECT_POINTER_ARRAY" : "OBJECT_POINTER";
+        columnArgs = hasLength
+            ? fmt::format("{}, {}, {}Object", prevFieldDisplayName, lengthField, elementName)
+            : fmt::format("{}, {}Object", prevFieldDisplayName, elementName);
+        codecArgs = hasLength
+            ? fmt::format("value->{}, value->{}, {}Object", prevFieldDisplayName, lengthField, elementName)
+            : fmt::format("value->{}, {}Object", prevFieldDisplayName, elementName);
+    }
+    else if (hasLength)
+    {
+        const auto kind = GetNumberTypeName(field.number);
+
+        column = "POINTER_ARRAY";
+        columnArgs = fmt::format("{}, {}, {}", prevFieldDisplayName, lengthField, kind);
+        codecArgs = fmt::format("value->{}, value->{}, {}", prevFieldDisplayName, lengthField, kind);
+    }
+    else if (field.pointeeIsChar)
+    {
+        column = "STRING";
+        columnArgs = prevFieldDisplayName;
+        codecArgs = fmt::format("value->{}", prevFieldDisplayName);
+    }
+    else
+    {
+        const auto kind = GetNumberTypeName(field.number);
+
+        column = "POINTER";
+        columnArgs = fmt::format("{}, {}", prevFieldDisplayName, kind);
+        codecArgs = fmt::format("value->{}, {}", prevFieldDisplayName, kind);
+    }
+
+    const auto suffix = HintSuffix(field);
+    const auto hintArgs = HintArgs(field);
+
+    fmt::format_to(
+        std::back_inserter(columnsBuffer),
+        "    DEFINE_COLUMN_{}{}({}, {}{}),\n",
+        column,
+        suffix,
+        currentObjectType,
+        columnArgs,
+        hintArgs
+    );
+
+    CodecMaxCount(field, lengthField);
+    CodecStatement(
+        fmt::format("CL_ENCODE_{}{}(writer, {}{})", column, suffix, codecArgs, hintArgs),
+        fmt::format("CL_DECODE_{}{}(reader, {}{})", column, suffix, codecArgs, hintArgs)
+    );
+
+    // the bench value is calloc'd, pointers stay NULL with an empty
+    // length and strings point at a fixed text.
+    if (hasLength)
+    {
+        BenchStatement(
+            fmt::format("value->{} = 0;", lengthField)
+        );
+    }
+    else if (field.pointeeIsChar && !field.elementName)
+    {
+        BenchStatement(
+            fmt::format("value->{} = clBenchString;", prevFieldDisplayName)
+        );
+    }
+
+    CloseColumnGroup(1);
+}
+
+// the runtime takes the size of a container from the value itself. a
+// decoded vector or string is sized once from the decoded count, a
+// std::array has a fixed one.
+void BuilderV1::DefineContainerField(const IrField& field)
+{
+    FlushNumberRun();
+    BeginField(field, false);
+
+    static const char *containerNames[] = {
+        "VECTOR",
+        "STD_ARRAY",
+        "STD_STRING",
+    };
+
+    const std::string container = containerNames[field.container];
+    const auto suffix = HintSuffix(field);
+    const auto hintArgs = HintArgs(field);
+
+    if (field.elementName)
+    {
+        const std::string elementName = field.elementName;
+
+        fmt::format_to(
+            std::back_inserter(columnsBuffer),
+            "    DEFINE_COLUMN_OBJECT_{}{}({}, {}, {}Object{}),\n",
+            container,
+            suffix,
+            currentObjectType,
+            prevFieldDisplayName,
+            elementName,
+            hintArgs
+        );
+
+        CodecContainerLoop(field, elementName);
+    }
+    else
+    {
+        // the characters of a string need no kind.
+        const auto kind = field.container != IrContainer_String
+            ? ", " + GetNumberTypeName(field.number)
+            : std::string();
+
+        fmt::format_to(
+            std::back_inserter(columnsBuffer),
+            "    DEFINE_COLUMN_{}{}({}, {}{}{}),\n",
+            container,
+            suffix,
+            currentObjectType,
+            prevFieldDisplayName,
+            kind,
+            hintArgs
+        );
+
+        CodecStatement(
+            fmt::format("CL_ENCODE_{}{}(writer, value->{}{}{})", container, suffix, prevFieldDisplayName, kind, hintArgs),
+            fmt::format("CL_DECODE_{}{}(reader, value->{}{}{})", container, suffix, prevFieldDisplayName, kind, hintArgs)
+        );
+    }
+
+    CloseColumnGroup(1);
+}
+
+// a clcli:max= capacity is checked before any element is touched.
+void BuilderV1::CodecMaxCount(const IrField& field, const std::string& lengthField)
+{
+    if (!field.maxCount || lengthField.empty())
+    {
+        return;
+    }
+
+    const auto check = fmt::format(
+        "    if ((size_t) value->{} > {})\n"
+        "    {{\n"
+        "        return CL_ERROR_LENGTH;\n"
+        "    }}\n",
+        lengthField,
+        field.maxCount
+    );
+
+    encodeBuffer.append(check.data(), check.data() + check.size());
+    decodeBuffer.append(check.data(), check.data() + check.size());
+}
+
+void BuilderV1::CodecStatement(const std::string& encode, const std::string& decode)
+{
+    fmt::format_to(
+        std::back_inserter(encodeBuffer),
+        "    CL_TRY({});\n",
+        encode
+    );
+
+    fmt::format_to(
+        std::back_inserter(decodeBuffer),
+        "    CL_TRY({});\n",
+        decode
+    );
+}
+
+void BuilderV1::CodecLengthCheck(const std::string& lengthField)
+{
+    if (lengthField.empty())
+    {
+        return;
+    }
+
+    const auto check = fmt::format(
+        "    if ((size_t) value->{} > CL_COUNTOF(value->{}))\n"
+        "    {{\n"
+        "        return CL_ERROR_LENGTH;\n"
+        "    }}\n",
+        lengthField,
+        prevFieldDisplayName
+    );
+
+    encodeBuffer.append(check.data(), check.data() + check.size());
+    decodeBuffer.append(check.data(), check.data() + check.size());
+}
+
+// the runtime walks the elements once per member, so each member goes
+// out as one contiguous column.
+void BuilderV1::CodecSoaArray(const std::string& elementName, const std::string& lengthField)
+{
+    CodecLengthCheck(lengthField);
+
+    const auto count = lengthField.empty()
+        ? fmt::format("CL_COUNTOF(value->{})", prevFieldDisplayName)
+        : fmt::format("(size_t) value->{}", lengthField);
+
+    CodecStatement(
+        fmt::format("CL_ENCODE_OBJECT_ARRAY_SOA(writer, value->{}, {}, {}Members)", prevFieldDisplayName, count, elementName),
+        fmt::format("CL_DECODE_OBJECT_ARRAY_SOA(reader, value->{}, {}, {}Members)", prevFieldDisplayName, count, elementName)
+    );
+}
+
+// union elements stay table driven, like a single union member.
+void BuilderV1::CodecObjectLoop(const IrField& field, const std::string& lengthField)
+{
+    codecNeedsIndex = true;
+    CodecLengthCheck(lengthField);
+
+    const std::string elementName = field.elementName;
+    const auto count = lengthField.empty()
+        ? fmt::format("CL_COUNTOF(value->{})", prevFieldDisplayName)
+        : fmt::format("(size_t) value->{}", lengthField);
+
+    const auto encode = field.elementIsUnion
+        ? fmt::format("CL_ENCODE_UNION(writer, value->{}[i], {}Columns)", prevFieldDisplayName, elementName)
+        : fmt::format("encode_{}(writer, &value->{}[i])", elementName, prevFieldDisplayName);
+    const auto decode = field.elementIsUnion
+        ? fmt::format("CL_DECODE_UNION(reader, value->{}[i], {}Columns)", prevFieldDisplayName, elementName)
+        : fmt::format("decode_{}(reader, &value->{}[i])", elementName, prevFieldDisplayName);
+
+    fmt::format_to(
+        std::back_inserter(encodeBuffer),
+        "    for (i = 0; i < {}; ++ i)\n"
+        "    {{\n"
+        "        CL_TRY({});\n"
+        "    }}\n",
+        count,
+        encode
+    );
+
+    fmt::format_to(
+        std::back_inserter(decodeBuffer),
+        "    for (i = 0; i < {}; ++ i)\n"
+        "    {{\n"
+        "        CL_TRY({});\n"
+        "    }}\n",
+        count,
+        decode
+    );
+}
+
+// the count of a vector goes first, CL_DECODE_VECTOR_SIZE resizes it
+// once and fails beyond the capacity, 0 for none.
+void BuilderV1::CodecContainerLoop(const IrField& field, const std::string& elementName)
+{
+    codecNeedsIndex = true;
+
+    if (field.container == IrContainer_Vector)
+    {
+        CodecStatement(
+            fmt::format("CL_ENCODE_VECTOR_SIZE(writer, value->{}, {})", prevFieldDisplayName, field.maxCount),
+            fmt::format("CL_DECODE_VECTOR_SIZE(reader, value->{}, {})", prevFieldDisplayName, field.maxCount)
+        );
+    }
+
+    fmt::format_to(
+        std::back_inserter(encodeBuffer),
+        "    for (i = 0; i < value->{}.size(); ++ i)\n"
+        "    {{\n"
+        "        CL_TRY(encode_{}(writer, &value->{}[i]));\n"
+        "    }}\n",
+        prevFieldDisplayName,
+        elementName,
+        prevFieldDisplayName
+    );
+
+    fmt::format_to(
+        std::back_inserter(decodeBuffer),
+        "    for (i = 0; i < value->{}.size(); ++ i)\n"
+        "    {{\n"
+        "        CL_TRY(decode_{}(reader, &value->{}[i]));\n"
+        "    }}\n",
+        prevFieldDisplayName,
+        elementName,
+        prevFieldDisplayName
+    );
+}
+
+void BuilderV1::DefineCodec()
+{
+    const char *index = codecNeedsIndex ? "    size_t i;\n\n" : "";
+    const char *unused = currentFieldNames.empty() ? "    (void) value;\n" : "";
+
+    fmt::format_to(
+        std::back_inserter(sourceBuffer),
+        "int encode_{}(struct clWriter *writer, const {} *value)\n"
+        "{{\n"
+        "{}{}{:.{}}"
+        "    (void) writer;\n"
+        "    return 0;\n"
+        "}}\n",
+        currentObjectDisplayName,
+        currentObjectType,
+        index,
+        unused,
+        encodeBuffer.data(),
+        encodeBuffer.size()
+    );
+
+    fmt::format_to(
+        std::back_inserter(sourceBuffer),
+        "int decode_{}(struct clReader *reader, {} *value)\n"
+        "{{\n"
+        "{}{}{:.{}}"
+        "    (void) reader;\n"
+        "    return 0;\n"
+        "}}\n",
+        currentObjectDisplayName,
+        currentObjectType,
+        index,
+        unused,
+        decodeBuffer.data(),
+        decodeBuffer.size()
+    );
+
+    fmt::format_to(
+        std::back_inserter(headerBuffer),
+        "int encode_{}(struct clWriter *writer, const {} *value);\n"
+        "int decode_{}(struct clReader *reader, {} *value);\n",
+        currentObjectDisplayName,
+        currentObjectType,
+        currentObjectDisplayName,
+        currentObjectType
+    );
+}
+
+void BuilderV1::BenchStatement(const std::string& statement)
+{
+    fmt::format_to(
+        std::back_inserter(fillBuffer),
+        "    {}\n",
+        statement
+    );
+}
+
+void BuilderV1::BenchFillNumbers(const std::string& field, NumberType type, bool isArray)
+{
+    const char *address = isArray ? "" : "&";
+
+    // random bytes are only valid for plain integers, bools get a
+    // valid value and floats a finite one, enums stay zeroed.
+    if (type.isEnum || type.kind == NumberKind_None)
+    {
+        return;
+    }
+
+    if (type.kind == NumberKind_Signed || type.kind == NumberKind_Unsigned)
+    {
+        BenchStatement(
+            fmt::format("clBenchFill({}value->{}, sizeof(value->{}), seed);", address, field, field)
+        );
+    }
+    else if (!isArray && type.kind == NumberKind_Bool)
+    {
+        BenchStatement(
+            fmt::format("value->{} = clBenchRandom(seed) & 1;", field)
+        );
+    }
+    else if (!isArray)
+    {
+        BenchStatement(
+            fmt::format("value->{} = clBenchRandom(seed) % 1000000 / 1000.0;", field)
+        );
+    }
+}
+
+void BuilderV1::BenchFillObjects(const IrField& field)
+{
+    // unions get no fill_ function, their elements stay zeroed like a
+    // single union member.
+    if (field.elementIsUnion)
+    {
+        return;
+    }
+
+    const std::string elementName = field.elementName;
+    benchNeedsIndex = true;
+
+    fmt::format_to(
+        std::back_inserter(fillBuffer),
+        "    for (i = 0; i < CL_COUNTOF(value->{}); ++ i)\n"
+        "    {{\n"
+        "        fill_{}(&value->{}[i], seed);\n"
+        "    }}\n",
+        prevFieldDisplayName,
+        elementName,
+        prevFieldDisplayName
+    );
+}
+
+void BuilderV1::BenchLength(const std::string& lengthField, uint32_t maxCount)
+{
+    // the flexible length is drawn within the array bounds, after the
+    // length field itself got random bytes.
+    const auto bound = maxCount ? fmt::format(" % {}", maxCount + 1ull) : std::string();
+
+    BenchStatement(
+        fmt::format(
+            "value->{} = clBenchRandom(seed) % (CL_COUNTOF(value->{}) + 1){};",
+            lengthField,
+            prevFieldDisplayName,
+            bound)
+    );
+}
+
+void BuilderV1::DefineBench()
+{
+    fmt::format_to(
+        std::back_inserter(benchBuffer),
+        "static void fill_{}({} *value, unsigned int *seed)\n"
+        "{{\n"
+        "{}"
+        "{:.{}}"
+        "    (void) value;\n"
+        "    (void) seed;\n"
+        "}}\n"
+        "\n"
+        "static void bench_{}(unsigned int iterations)\n"
+        "{{\n"
+        "    unsigned int seed = 1;\n"
+        "    {} *value = ({} *) calloc(1, sizeof({}));\n"
+        "    {} *decoded = ({} *) calloc(1, sizeof({}));\n"
+        "\n"
+        "    fill_{}(value, &seed);\n"
+        "    clBenchRun(\"{}\", {}Object, value, decoded, sizeof({}), iterations);\n"
+        "\n"
+        "    free(value);\n"
+        "    free(decoded);\n"
+        "}}\n",
+        currentObjectDisplayName,
+        currentObjectType,
+        benchNeedsIndex ? "    size_t i;\n\n" : "",
+        fillBuffer.data(),
+        fillBuffer.size(),
+        currentObjectDisplayName,
+        currentObjectType,
+        currentObjectType,
+        currentObjectType,
+        currentObjectType,
+        currentObjectType,
+        currentObjectType,
+        currentObjectDisplayName,
+        currentObjectDisplayName,
+        currentObjectDisplayName,
+        currentObjectType
+    );
+}
+
+std::string BuilderV1::GetBenchSource()
+{
+    fmt::memory_buffer source;
+    fmt::format_to(
+        std::back_inserter(source),
+        "// generated by the clcli. DO NOT EDIT!\n\n"
+    );
+
+    fmt::format_to(
+        std::back_inserter(source),
+        "#include <stdio.h>\n"
+        "#include <stdlib.h>\n"
+        "#include <time.h>\n"
+        "#include <columns.h>\n"
+    );
+
+    WriteIncludes(&source);
+
+    // CL_BENCH_ENCODE/CL_BENCH_DECODE come from the runtime, they return
+    // the encoded size and an error code like the table-driven calls.
+    fmt::format_to(
+        std::back_inserter(source),
+        "\n"
+        "\n"
+        "#ifndef CL_COUNTOF\n"
+        "#define CL_COUNTOF(array) (sizeof(array) / sizeof((array)[0]))\n"
+        "#endif\n"
+        "#ifndef CL_BENCH_ALLOCATIONS\n"
+        "#define CL_BENCH_ALLOCATIONS() 0\n"
+        "#endif\n"
+        "\n"
+        "static unsigned int clBenchRandom(unsigned int *seed)\n"
+        "{{\n"
+        "    *seed = *seed * 1103515245u + 12345u;\n"
+        "    return *seed >> 16;\n"
+        "}}\n"
+        "\n"
+        "static void clBenchFill(void *data, size_t size, unsigned int *seed)\n"
+        "{{\n"
+        "    unsigned char *bytes = (unsigned char *) data;\n"
+        "    size_t i;\n"
+        "\n"
+        "    for (i = 0; i < size; ++ i)\n"
+        "    {{\n"
+        "        bytes[i] = (unsigned char) clBenchRandom(seed);\n"
+        "    }}\n"
+        "}}\n"
+        "\n"
+        "static char clBenchString[] = \"clcli bench string\";\n"
+        "\n"
+        "static double clBenchNow(void)\n"
+        "{{\n"
+        "    struct timespec now;\n"
+        "    clock_gettime(CLOCK_MONOTONIC, &now);\n"
+        "    return now.tv_sec + now.tv_nsec * 1e-9;\n"
+        "}}\n"
+        "\n"
+        "static void clBenchRun(\n"
+        "    const char *name,\n"
+        "    const struct clColumn *object,\n"
+        "    const void *value,\n"
+        "    void *decoded,\n"
+        "    size_t size,\n"
+        "    unsigned int iterations)\n"
+        "{{\n"
+        "    const size_t capacity = size * 4 + 4096;\n"
+        "    unsigned char *buffer = (unsigned char *) malloc(capacity);\n"
+        "    size_t encoded = 0;\n"
+        "    unsigned int i;\n"
+        "\n"
+        "    const double allocations = CL_BENCH_ALLOCATIONS();\n"
+        "    const double encodeStart = clBenchNow();\n"
+        "    for (i = 0; i < iterations; ++ i)\n"
+        "    {{\n"
+        "        encoded = CL_BENCH_ENCODE(object, value, buffer, capacity);\n"
+        "    }}\n"
+        "\n"
+        "    const double decodeStart = clBenchNow();\n"
+        "    for (i = 0; i < iterations; ++ i)\n"
+        "    {{\n"
+        "        CL_BENCH_DECODE(object, decoded, buffer, encoded);\n"
+        "    }}\n"
+        "\n"
+        "    const double end = clBenchNow();\n"
+        "    const double encodeTime = (decodeStart - encodeStart) / iterations;\n"
+        "    const double decodeTime = (end - decodeStart) / iterations;\n"
+        "\n"
+        "    printf(\n"
+        "        \"%-32s encode %10.1f ns %10.1f MB/s  decode %10.1f ns %10.1f MB/s  %8zu bytes  %6.2f allocs\\n\",\n"
+        "        name,\n"
+        "        encodeTime * 1e9,\n"
+        "        encoded / encodeTime / 1e6,\n"
+        "        decodeTime * 1e9,\n"
+        "        encoded / decodeTime / 1e6,\n"
+        "        encoded,\n"
+        "        (CL_BENCH_ALLOCATIONS() - allocations) / iterations / 2);\n"
+        "\n"
+        "    free(buffer);\n"
+        "}}\n"
+    );
+
+    for (const auto& object : objects)
+    {
+        if (!object.bench.empty())
+        {
+            fmt::format_to(
+                std::back_inserter(source),
+                "\n"
+            );
+
+            source.append(object.bench.data(), object.bench.data() + object.bench.size());
+        }
+    }
+
+    fmt::format_to(
+        std::back_inserter(source),
+        "\n"
+        "int main(int argc, char *argv[])\n"
+        "{{\n"
+        "    const unsigned int iterations = argc > 1 ? (unsigned int) atoi(argv[1]) : 100000;\n"
+        "\n"
+    );
+
+    for (const auto& object : objects)
+    {
+        if (!object.bench.empty())
+        {
+            fmt::format_to(
+                std::back_inserter(source),
+                "    bench_{}(iterations);\n",
+                object.name
+            );
+        }
+    }
+
+    fmt::format_to(
+        std::back_inserter(source),
+        "    return 0;\n"
+        "}}\n"
+    );
+
+    return {
+        source.data(),
+        source.size(),
+    };
+}
+
+// with the codec the generated header already includes the inputs,
+// which need not have guards, so the sources only include the header.
+void BuilderV1::WriteIncludes(fmt::memory_buffer *buffer) const
+{
+    const size_t count = (flags & BuilderFlag_Codec)
+        ? std::min<size_t>(includedFiles.size(), 1)
+        : includedFiles.size();
+
+    for (size_t i = 0; i < count; ++ i)
+    {
+        fmt::format_to(
+            std::back_inserter(*buffer),
+            "\n#include \"{}\"",
+            includedFiles[i]
+        );
+    }
+}
+
+void BuilderV1::WriteSource(const SourceSink& sink, uint32_t shard, uint32_t shardCount)
+{
+    fmt::memory_buffer source;
+    fmt::format_to(
+        std::back_inserter(source),
+        "// generated by the clcli. DO NOT EDIT!\n\n"
+    );
+
+    fmt::format_to(
+        std::back_inserter(source),
+        "#include <columns.h>\n"
+    );
+
+    WriteIncludes(&source);
+    
+    fmt::format_to(
+        std::back_inserter(source),
+        "\n"
+    );
+
+    if (flags & BuilderFlag_Codec)
+    {
+        fmt::format_to(
+            std::back_inserter(source),
+            "\n"
+            "#ifndef CL_TRY\n"
+            "#define CL_TRY(expr) do {{ int error_ = (expr); if (error_) return error_; }} while (0)\n"
+            "#endif\n"
+            "#ifndef CL_COUNTOF\n"
+            "#define CL_COUNTOF(array) (sizeof(array) / sizeof((array)[0]))\n"
+            "#endif\n"
+            "#ifndef CL_ERROR_LENGTH\n"
+            "#define CL_ERROR_LENGTH (-1)\n"
+            "#endif\n"
+        );
+    }
+
+    // the names of every record in the file share one blob, sorted so
+    // that names with a common prefix share cache lines.
+    std::set<std::string> names;
+    for (const auto& object : objects)
+    {
+        if (IsInShard(object, shard, shardCount))
+        {
+            names.insert(object.names.begin(), object.names.end());
+        }
+    }
+
+    if (!names.empty())
+    {
+        fmt::format_to(
+            std::back_inserter(source),
+            "\n"
+            "static const char clNames[] =\n"
+        );
+
+        size_t count = 0;
+        for (const auto& name : names)
+        {
+            fmt::format_to(
+                std::back_inserter(source),
+                "    \"{}\\0\"{}\n",
+                name,
+                ++ count == names.size() ? ";" : ""
+            );
+        }
+
+        fmt::format_to(
+            std::back_inserter(source),
+            "\n"
+            "enum\n"
+            "{{\n"
+        );
+
+        size_t offset = 0;
+        for (const auto& name : names)
+        {
+            fmt::format_to(
+                std::back_inserter(source),
+                "    clName_{} = {},\n",
+                name,
+                offset
+            );
+
+            offset += name.size() + 1;
+        }
+
+        fmt::format_to(
+            std::back_inserter(source),
+            "}};\n"
+        );
+    }
+
+    // the fragments go to the sink as they are, only the short
+    // separators are formatted.
+    for (const auto& object : objects)
+    {
+        if (!IsInShard(object, shard, shardCount))
+        {
+            continue;
+        }
+
+        fmt::format_to(
+            std::back_inserter(source),
+            "\n"
+        );
+
+        if (object.inputs.size() > 1)
+        {
+            fmt::format_to(
+                std::back_inserter(source),
+                "// shared by {}\n",
+                fmt::join(object.inputs, ", ")
+            );
+        }
+
+        sink(source.data(), source.size());
+        source.clear();
+
+        sink(object.source.data(), object.source.size());
+    }
+
+    sink(source.data(), source.size());
+}
+
+std::string BuilderV1::GetSourceHeader()
+{
+    fmt::memory_buffer sourceHeader;
+    fmt::format_to(
+        std::back_inserter(sourceHeader),
+        "// generated by the clcli. DO NOT EDIT!\n\n"
+    );
+
+    fmt::format_to(
+        std::back_inserter(sourceHeader),
+        "#pragma once\n\n"
     );
     
     fmt::format_to(
         std::back_inserter(sourceHeader),
         "struct clColumn;\n"
     );
+
+    if (flags & BuilderFlag_Soa)
+    {
+        fmt::format_to(
+            std::back_inserter(sourceHeader),
+            "struct clSoaMember;\n"
+        );
+    }
+
+    // the codec prototypes name the record types, so the inputs are
+    // needed here.
+    if (flags & BuilderFlag_Codec)
+    {
+        fmt::format_to(
+            std::back_inserter(sourceHeader),
+            "struct clWriter;\n"
+            "struct clReader;\n"
+        );
+
+        for (size_t i = 1; i < includedFiles.size(); ++ i)
+        {
+            fmt::format_to(
+                std::back_inserter(sourceHeader),
+                "\n#include \"{}\"",
+                includedFiles[i]
+            );
+        }
+
+        if (includedFiles.size() > 1)
+        {
+            fmt::format_to(
+                std::back_inserter(sourceHeader),
+                "\n"
+            );
+        }
+    }
+
+    fmt::format_to(
+        std::back_inserter(sourceHeader),
+        "\n"
+        "#ifndef CL_FIELD_HASH\n"
+        "#define CL_FIELD_HASH\n"
+        "// column = FieldSlots[clFieldHash(name, len, FieldSeeds[clFieldHash(name, len, 0) & mask]) & mask] - 1\n"
+        "static inline unsigned int clFieldHash(const char *name, unsigned int len, unsigned int seed)\n"
+        "{{\n"
+        "    unsigned int hash = seed ^ 2166136261u;\n"
+        "    for (unsigned int i = 0; i < len; ++ i)\n"
+        "    {{\n"
+        "        hash ^= (unsigned char) name[i];\n"
+        "        hash *= 16777619u;\n"
+        "    }}\n"
+        "    return hash;\n"
+        "}}\n"
+        "#endif\n"
+    );
     
     fmt::format_to(
         std::back_inserter(sourceHeader),
-        "\n{:.{}}", 
-        headerBuffer.data(), 
-        headerBuffer.size()
+        "\n"
     );
 
+    for (const auto& object : objects)
+    {
+        sourceHeader.append(object.header.data(), object.header.data() + object.header.size());
+    }
+
     return {
         sourceHeader.data(),
         sourceHeader.size(),
     };
 }
 
-Builder *NewBuilder()
+Builder *NewBuilder(BuilderBackend backend, uint32_t flags, const FieldProfile *profile)
 {
-    return new BuilderV1();
+    switch (backend)
+    {
+        case BuilderBackend_Constexpr:
+            return NewConstexprBuilder();
+        default:
+        {
+            auto builder = new BuilderV1();
+            builder->flags = flags;
+            builder->profile = profile;
+            return builder;
+        }
+    }
 }
 
 void FreeBuilder(Builder *builder)
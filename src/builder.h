@@ -1,24 +1,59 @@
 #pragma once
 
 #include <string>
-#include <clang-c/Index.h>
+#include <cstdint>
+#include <functional>
+
+#include "ir.h"
+
+// receives generated code chunk by chunk, so a large output never has
+// to exist as one string.
+typedef std::function<void (const char *data, size_t size)> SourceSink;
 
 struct Builder
 {
-    virtual void EnterObject(CXCursor cursor) = 0;
+    virtual void EnterObject(const IrRecord& record) = 0;
     virtual void LeaveObject() = 0;
 
-    virtual void DefineNumberField(CXCursor cursor) = 0;
-    virtual void DefineArrayField(CXCursor cursor, CXCursor element) = 0;
-    virtual void DefineObjectField(CXCursor cursor) = 0;
+    virtual void DefineNumberField(const IrField& field) = 0;
+    virtual void DefineArrayField(const IrField& field) = 0;
+    virtual void DefineObjectField(const IrField& field) = 0;
+    virtual void DefinePointerField(const IrField& field) = 0;
+    virtual void DefineContainerField(const IrField& field) = 0;
 
     virtual void Include(std::string name) = 0;
+    virtual void Merge(Builder *other) = 0;
+
+    virtual void Save(std::string *data) = 0;
+    virtual bool Load(const std::string& data) = 0;
 
     virtual std::string GetSource() = 0;
+    virtual void WriteSource(const SourceSink& sink, uint32_t shard, uint32_t shardCount) = 0;
     virtual std::string GetSourceHeader() = 0;
+    virtual std::string GetBenchSource() = 0;
 
     virtual ~Builder() = default;
 };
 
-Builder *NewBuilder();
+struct FieldProfile;
+
+enum BuilderBackend
+{
+    BuilderBackend_Columns,
+    BuilderBackend_Constexpr,
+};
+
+enum BuilderFlags
+{
+    BuilderFlag_Codec = 1 << 0,
+    BuilderFlag_Bench = 1 << 1,
+    BuilderFlag_Soa = 1 << 2,
+};
+
+// the profile, when given, orders the column tables hot-first and has
+// to outlive the builder.
+Builder *NewBuilder(
+    BuilderBackend backend = BuilderBackend_Columns,
+    uint32_t flags = 0,
+    const FieldProfile *profile = nullptr);
 void FreeBuilder(Builder *builder);
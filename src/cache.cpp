@@ -0,0 +1,161 @@
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <fmt/format.h>
+
+#include "cache.h"
+#include "builder.h"
+#include "util.h"
+
+// bump whenever the entry layout or the builder payload changes.
+static const char *kCacheMagic = "clcli-cache 11\n";
+
+static std::string CacheEntryPath(
+    const std::string& cacheDir,
+    const std::string& input,
+    uint64_t argsHash)
+{
+    return fmt::format(
+        "{}/{:016x}.cache",
+        cacheDir,
+        HashBytes(input.data(), input.size(), argsHash)
+    );
+}
+
+static bool HashFile(const std::string& path, uint64_t *hash)
+{
+    std::string contents;
+    if (!ReadFile(path, &contents))
+    {
+        return false;
+    }
+
+    *hash = HashBytes(contents.data(), contents.size());
+    return true;
+}
+
+static bool ReadLine(const std::string& data, size_t *pos, std::string *line)
+{
+    const size_t newline = data.find('\n', *pos);
+    if (newline == std::string::npos)
+    {
+        return false;
+    }
+
+    line->assign(data, *pos, newline - *pos);
+    *pos = newline + 1;
+    return true;
+}
+
+bool LoadCacheEntry(
+    const std::string& cacheDir,
+    const std::string& input,
+    uint64_t argsHash,
+    Builder *builder,
+    std::vector<std::string> *dependencies)
+{
+    std::string data;
+    if (!ReadFile(CacheEntryPath(cacheDir, input, argsHash), &data))
+    {
+        return false;
+    }
+
+    const std::string magic = kCacheMagic;
+    if (data.compare(0, magic.size(), magic))
+    {
+        return false;
+    }
+
+    size_t pos = magic.size();
+    std::string line;
+    if (!ReadLine(data, &pos, &line)
+        || strtoull(line.c_str(), nullptr, 16) != argsHash)
+    {
+        return false;
+    }
+
+    if (!ReadLine(data, &pos, &line))
+    {
+        return false;
+    }
+
+    // every file of the inclusion closure must still hash the same,
+    // otherwise the input has to go through libclang again.
+    std::vector<std::string> files;
+    const size_t count = strtoull(line.c_str(), nullptr, 10);
+    for (size_t i = 0; i < count; ++ i)
+    {
+        if (!ReadLine(data, &pos, &line))
+        {
+            return false;
+        }
+
+        const size_t space = line.find(' ');
+        if (space == std::string::npos)
+        {
+            return false;
+        }
+
+        uint64_t hash = 0;
+        std::string file = line.substr(space + 1);
+        if (!HashFile(file, &hash)
+            || hash != strtoull(line.c_str(), nullptr, 16))
+        {
+            return false;
+        }
+
+        files.push_back(std::move(file));
+    }
+
+    if (!builder->Load(data.substr(pos)))
+    {
+        return false;
+    }
+
+    dependencies->insert(dependencies->end(), files.begin(), files.end());
+    return true;
+}
+
+void StoreCacheEntry(
+    const std::string& cacheDir,
+    const std::string& input,
+    uint64_t argsHash,
+    Builder *builder,
+    const std::vector<std::string>& dependencies)
+{
+    std::string data = kCacheMagic;
+    data.append(fmt::format("{:016x}\n", argsHash));
+    data.append(fmt::format("{}\n", dependencies.size()));
+
+    for (const auto& dependency : dependencies)
+    {
+        uint64_t hash = 0;
+        if (!HashFile(dependency, &hash))
+        {
+            return;
+        }
+
+        data.append(fmt::format("{:016x} {}\n", hash, dependency));
+    }
+
+    builder->Save(&data);
+
+    mkdir(cacheDir.c_str(), 0755);
+
+    // written aside and renamed, a crash never leaves a torn entry.
+    const auto path = CacheEntryPath(cacheDir, input, argsHash);
+    const auto temporaryPath = fmt::format("{}.tmp", path);
+
+    FILE *f = fopen(temporaryPath.c_str(), "wb");
+    if (!f)
+    {
+        return;
+    }
+
+    const bool success = fwrite(data.data(), 1, data.size(), f) == data.size();
+    if (fclose(f) || !success
+        || rename(temporaryPath.c_str(), path.c_str()))
+    {
+        remove(temporaryPath.c_str());
+    }
+}
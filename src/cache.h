@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct Builder;
+
+bool LoadCacheEntry(
+    const std::string& cacheDir,
+    const std::string& input,
+    uint64_t argsHash,
+    Builder *builder,
+    std::vector<std::string> *dependencies);
+
+void StoreCacheEntry(
+    const std::string& cacheDir,
+    const std::string& input,
+    uint64_t argsHash,
+    Builder *builder,
+    const std::vector<std::string>& dependencies);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <clang-c/Index.h>
+
+#include "stats.h"
+#include "builder.h"
+#include "profile.h"
+
+struct ClcliOptions
+{
+    bool isCpp = false;
+    bool serve = false;
+    uint32_t jobs = 1;
+    uint32_t shards = 1;
+    BuilderBackend backend = BuilderBackend_Columns;
+    uint32_t builderFlags = 0;
+    std::string workdir = ".";
+    std::string standard = "";
+    std::string output = "messages";
+    std::vector<std::string> inputs;
+    std::vector<std::string> includeDirs;
+    std::vector<std::string> prefixHeaders;
+    std::vector<std::string> roots;
+    std::string pchFile;
+    std::string cacheDir;
+    std::string depfile;
+    std::string profile;
+    FieldProfile fieldProfile;
+    ReportFormat stats = ReportFormat_None;
+    ReportFormat layoutReport = ReportFormat_None;
+};
+
+void BuildClangArgs(
+    struct ClcliOptions *options,
+    bool isHeader,
+    std::vector<std::string> *storage,
+    std::vector<const char *> *clangArgs);
+
+uint32_t PrintDiagnostics(CXTranslationUnit translationUnit);
+
+void RunJobs(
+    uint32_t jobs,
+    uint32_t count,
+    const std::function<void (uint32_t)>& job);
+
+Builder *NewOutputBuilder(struct ClcliOptions *options);
+void WriteOutputs(
+    struct ClcliOptions *options,
+    Builder *builder,
+    const std::vector<std::string>& dependencies,
+    Stats *stats = nullptr);
@@ -0,0 +1,481 @@
+#include <string>
+#include <cassert>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include "builder.h"
+#include "fragment.h"
+
+// emits the tables as constexpr descriptors plus a clTraits<T>
+// specialization per record, so C++ encoders and decoders can be
+// instantiated per type instead of interpreting clColumn tables.
+struct BuilderConstexpr : public FragmentBuilder
+{
+    void EnterObject(const IrRecord& record) override;
+    void LeaveObject() override;
+
+    void DefineNumberField(const IrField& field) override;
+    void DefineArrayField(const IrField& field) override;
+    void DefineObjectField(const IrField& field) override;
+    void DefinePointerField(const IrField& field) override;
+    void DefineContainerField(const IrField& field) override;
+
+    void DefineField(const char *kind, const IrField& field, const std::string& lengthField);
+    void DefineBitfield(const IrField& field);
+
+    void WriteSource(const SourceSink& sink, uint32_t shard, uint32_t shardCount) override;
+    std::string GetSourceHeader() override;
+    std::string GetBenchSource() override;
+
+    size_t fieldCount = 0;
+    fmt::memory_buffer fieldsBuffer;
+    fmt::memory_buffer visitBuffer;
+    fmt::memory_buffer accessorBuffer;
+};
+
+static const char *GetNumberKindName(NumberKind kind)
+{
+    switch (kind)
+    {
+        case NumberKind_Bool:
+            return "Bool";
+        case NumberKind_Signed:
+            return "Signed";
+        case NumberKind_Unsigned:
+            return "Unsigned";
+        case NumberKind_Float:
+            return "Float";
+        case NumberKind_LongDouble:
+            return "LongDouble";
+        default:
+            return "None";
+    }
+}
+
+static const char *GetEncodingName(IrEncoding encoding)
+{
+    switch (encoding)
+    {
+        case IrEncoding_Varint:
+            return "Varint";
+        case IrEncoding_Zigzag:
+            return "Zigzag";
+        case IrEncoding_Fixed:
+            return "Fixed";
+        case IrEncoding_Delta:
+            return "Delta";
+        default:
+            return "Default";
+    }
+}
+
+void BuilderConstexpr::EnterObject(const IrRecord& record)
+{
+    BeginObject(record);
+    LineInfo(record.location, &headerBuffer);
+
+    fieldCount = 0;
+    fieldsBuffer.clear();
+    visitBuffer.clear();
+    accessorBuffer.clear();
+}
+
+void BuilderConstexpr::LeaveObject()
+{
+    assert(inObject);
+
+    fmt::format_to(
+        std::back_inserter(headerBuffer),
+        "template <>\n"
+        "struct clTraits<{}>\n"
+        "{{\n"
+        "    typedef {} type;\n"
+        "    static constexpr const char *name = \"{}\";\n"
+        "    static constexpr bool isUnion = {};\n"
+        "    static constexpr std::size_t fieldCount = {};\n",
+        currentObjectType,
+        currentObjectType,
+        currentObjectDisplayName,
+        isUnion ? "true" : "false",
+        fieldCount
+    );
+
+    if (fieldCount)
+    {
+        fmt::format_to(
+            std::back_inserter(headerBuffer),
+            "    static constexpr clFieldDescriptor fields[] = {{\n"
+            "{:.{}}"
+            "    }};\n",
+            fieldsBuffer.data(),
+            fieldsBuffer.size()
+        );
+
+        // before C++17 static constexpr members are not implicitly inline.
+        fmt::format_to(
+            std::back_inserter(sourceBuffer),
+            "#if __cplusplus < 201703L\n"
+            "constexpr clFieldDescriptor clTraits<{}>::fields[];\n"
+            "#endif\n",
+            currentObjectType
+        );
+    }
+
+    fmt::format_to(
+        std::back_inserter(headerBuffer),
+        "{:.{}}"
+        "\n"
+        "    template <typename Visitor, typename Value>\n"
+        "    static void Visit(Visitor& visitor, Value& value)\n"
+        "    {{\n"
+        "{:.{}}"
+        "    }}\n"
+        "}};\n",
+        accessorBuffer.data(),
+        accessorBuffer.size(),
+        visitBuffer.data(),
+        visitBuffer.size()
+    );
+
+    EndObject();
+}
+
+void BuilderConstexpr::DefineField(const char *kind, const IrField& field, const std::string& lengthField)
+{
+    const NumberType numberType = field.number;
+    ++ fieldCount;
+
+    fmt::format_to(
+        std::back_inserter(fieldsBuffer),
+        "        {{\"{}\", offsetof({}, {}), sizeof({}::{}), clFieldKind::{}, clNumberKind::{}, {}, {}, 0, 0, clEncoding::{}, {}}},\n",
+        prevFieldDisplayName,
+        currentObjectType,
+        prevFieldDisplayName,
+        currentObjectType,
+        prevFieldDisplayName,
+        kind,
+        GetNumberKindName(numberType.kind),
+        numberType.size,
+        numberType.isEnum ? "true" : "false",
+        GetEncodingName(field.encoding),
+        field.maxCount
+    );
+
+    if (lengthField.empty())
+    {
+        fmt::format_to(
+            std::back_inserter(visitBuffer),
+            "        visitor.{}(\"{}\", value.{});\n",
+            kind,
+            prevFieldDisplayName,
+            prevFieldDisplayName
+        );
+    }
+    else
+    {
+        fmt::format_to(
+            std::back_inserter(visitBuffer),
+            "        visitor.{}(\"{}\", value.{}, value.{});\n",
+            kind,
+            prevFieldDisplayName,
+            prevFieldDisplayName,
+            lengthField
+        );
+    }
+}
+
+void BuilderConstexpr::DefineBitfield(const IrField& field)
+{
+    uint64_t unitOffset;
+    uint32_t unitSize;
+    GetBitfieldUnit(field, &unitOffset, &unitSize);
+
+    ++ fieldCount;
+
+    fmt::format_to(
+        std::back_inserter(fieldsBuffer),
+        "        {{\"{}\", {}, {}, clFieldKind::Bitfield, clNumberKind::{}, {}, {}, {}, {}, clEncoding::Default, 0}},\n",
+        prevFieldDisplayName,
+        unitOffset,
+        unitSize,
+        GetNumberKindName(field.number.kind),
+        field.number.size,
+        field.number.isEnum ? "true" : "false",
+        field.offset - unitOffset * 8,
+        field.bitWidth
+    );
+
+    // a bitfield cannot be bound to a reference, visitors get the record
+    // and a getter/setter pair instead.
+    fmt::format_to(
+        std::back_inserter(accessorBuffer),
+        "\n"
+        "    static unsigned long long GetBits_{}(const {}& value)\n"
+        "    {{\n"
+        "        return static_cast<unsigned long long>(value.{});\n"
+        "    }}\n"
+        "\n"
+        "    static void SetBits_{}({}& value, unsigned long long bits)\n"
+        "    {{\n"
+        "        value.{} = static_cast<decltype(value.{})>(bits);\n"
+        "    }}\n",
+        prevFieldDisplayName,
+        currentObjectType,
+        prevFieldDisplayName,
+        prevFieldDisplayName,
+        currentObjectType,
+        prevFieldDisplayName,
+        prevFieldDisplayName
+    );
+
+    fmt::format_to(
+        std::back_inserter(visitBuffer),
+        "        visitor.Bitfield(\"{}\", value, &GetBits_{}, &SetBits_{});\n",
+        prevFieldDisplayName,
+        prevFieldDisplayName,
+        prevFieldDisplayName
+    );
+}
+
+void BuilderConstexpr::DefineNumberField(const IrField& field)
+{
+    BeginField(field, true);
+
+    if (field.isBitField)
+    {
+        DefineBitfield(field);
+        return;
+    }
+
+    DefineField("Number", field, {});
+}
+
+void BuilderConstexpr::DefineArrayField(const IrField& field)
+{
+    const std::string lengthField = GetLengthField(field);
+    const bool isFlexibleArray = !lengthField.empty();
+    const bool isObject = field.elementName != nullptr;
+
+    BeginField(field, false);
+
+    if (isFlexibleArray)
+    {
+        DefineField(isObject ? "ObjectFlexibleArray" : "FlexibleArray", field, lengthField);
+    }
+    else
+    {
+        DefineField(isObject ? "ObjectFixedArray" : "FixedArray", field, {});
+    }
+}
+
+void BuilderConstexpr::DefineObjectField(const IrField& field)
+{
+    BeginField(field, false);
+    DefineField(!field.elementIsUnion ? "Object" : "Union", field, {});
+}
+
+void BuilderConstexpr::DefinePointerField(const IrField& field)
+{
+    const std::string lengthField = field.lengthField ? field.lengthField : "";
+    const bool hasLength = !lengthField.empty();
+    const bool isObject = field.elementName != nullptr;
+
+    BeginField(field, false);
+
+    if (hasLength)
+    {
+        DefineField(isObject ? "ObjectPointerArray" : "PointerArray", field, lengthField);
+    }
+    else if (isObject)
+    {
+        DefineField("ObjectPointer", field, {});
+    }
+    else
+    {
+        DefineField(field.pointeeIsChar ? "String" : "Pointer", field, {});
+    }
+}
+
+void BuilderConstexpr::DefineContainerField(const IrField& field)
+{
+    const bool isObject = field.elementName != nullptr;
+
+    BeginField(field, false);
+
+    switch (field.container)
+    {
+        case IrContainer_Vector:
+            DefineField(isObject ? "ObjectVector" : "Vector", field, {});
+            break;
+        case IrContainer_Array:
+            DefineField(isObject ? "ObjectStdArray" : "StdArray", field, {});
+            break;
+        case IrContainer_String:
+            DefineField("StdString", field, {});
+            break;
+    }
+}
+
+void BuilderConstexpr::WriteSource(const SourceSink& sink, uint32_t shard, uint32_t shardCount)
+{
+    fmt::memory_buffer source;
+    fmt::format_to(
+        std::back_inserter(source),
+        "// generated by the clcli. DO NOT EDIT!\n"
+    );
+
+    if (!includedFiles.empty())
+    {
+        fmt::format_to(
+            std::back_inserter(source),
+            "\n#include \"{}\"\n",
+            includedFiles.front()
+        );
+    }
+
+    for (const auto& object : objects)
+    {
+        if (!object.source.empty() && IsInShard(object, shard, shardCount))
+        {
+            fmt::format_to(
+                std::back_inserter(source),
+                "\n"
+            );
+
+            sink(source.data(), source.size());
+            source.clear();
+
+            sink(object.source.data(), object.source.size());
+        }
+    }
+
+    sink(source.data(), source.size());
+}
+
+std::string BuilderConstexpr::GetSourceHeader()
+{
+    fmt::memory_buffer sourceHeader;
+    fmt::format_to(
+        std::back_inserter(sourceHeader),
+        "// generated by the clcli. DO NOT EDIT!\n\n"
+    );
+
+    fmt::format_to(
+        std::back_inserter(sourceHeader),
+        "#pragma once\n\n"
+    );
+
+    fmt::format_to(
+        std::back_inserter(sourceHeader),
+        "#include <cstddef>\n"
+    );
+
+    for (size_t i = 1; i < includedFiles.size(); ++ i)
+    {
+        fmt::format_to(
+            std::back_inserter(sourceHeader),
+            "\n#include \"{}\"",
+            includedFiles[i]
+        );
+    }
+
+    fmt::format_to(
+        std::back_inserter(sourceHeader),
+        "\n\n"
+        "#ifndef CL_TRAITS\n"
+        "#define CL_TRAITS\n"
+        "enum class clFieldKind\n"
+        "{{\n"
+        "    Number,\n"
+        "    FixedArray,\n"
+        "    FlexibleArray,\n"
+        "    Object,\n"
+        "    Union,\n"
+        "    ObjectFixedArray,\n"
+        "    ObjectFlexibleArray,\n"
+        "    Bitfield,\n"
+        "    String,\n"
+        "    Pointer,\n"
+        "    PointerArray,\n"
+        "    ObjectPointer,\n"
+        "    ObjectPointerArray,\n"
+        "    Vector,\n"
+        "    ObjectVector,\n"
+        "    StdArray,\n"
+        "    ObjectStdArray,\n"
+        "    StdString,\n"
+        "}};\n"
+        "\n"
+        "enum class clEncoding\n"
+        "{{\n"
+        "    Default,\n"
+        "    Varint,\n"
+        "    Zigzag,\n"
+        "    Fixed,\n"
+        "    Delta,\n"
+        "}};\n"
+        "\n"
+        "enum class clNumberKind\n"
+        "{{\n"
+        "    None,\n"
+        "    Bool,\n"
+        "    Signed,\n"
+        "    Unsigned,\n"
+        "    Float,\n"
+        "    LongDouble,\n"
+        "}};\n"
+        "\n"
+        "struct clFieldDescriptor\n"
+        "{{\n"
+        "    const char *name;\n"
+        "    std::size_t offset;\n"
+        "    std::size_t size;\n"
+        "    clFieldKind kind;\n"
+        "    clNumberKind number;\n"
+        "    std::size_t numberSize;\n"
+        "    bool isEnum;\n"
+        "    unsigned bitOffset;\n"
+        "    unsigned bitWidth;\n"
+        "    clEncoding encoding;\n"
+        "    std::size_t maxCount;\n"
+        "}};\n"
+        "\n"
+        "template <typename T>\n"
+        "struct clTraits;\n"
+        "#endif\n"
+    );
+
+    for (const auto& object : objects)
+    {
+        fmt::format_to(
+            std::back_inserter(sourceHeader),
+            "\n"
+        );
+
+        if (object.inputs.size() > 1)
+        {
+            fmt::format_to(
+                std::back_inserter(sourceHeader),
+                "// shared by {}\n",
+                fmt::join(object.inputs, ", ")
+            );
+        }
+
+        sourceHeader.append(object.header.data(), object.header.data() + object.header.size());
+    }
+
+    return {
+        sourceHeader.data(),
+        sourceHeader.size(),
+    };
+}
+
+std::string BuilderConstexpr::GetBenchSource()
+{
+    return {};
+}
+
+Builder *NewConstexprBuilder()
+{
+    return new BuilderConstexpr();
+}
@@ -0,0 +1,384 @@
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include "fragment.h"
+#include "util.h"
+
+std::string StripPrefixDot(const std::string& path)
+{
+    if (boost::algorithm::istarts_with(path, "./")
+        || boost::algorithm::istarts_with(path, ".\\"))
+    {
+        return {
+            path.data() + 2,
+            path.size() - 2
+        };
+    }
+    else
+    {
+        return path;
+    }
+}
+
+bool IsInShard(const ObjectFragment& object, uint32_t shard, uint32_t shardCount)
+{
+    // keyed by the USR only, a record keeps its shard while others come
+    // and go, so an edit only rebuilds the shard that holds it. tables
+    // another record refers to by name are not static, that record may
+    // be emitted into another shard.
+    return shardCount <= 1
+        || HashBytes(object.usr.data(), object.usr.size()) % shardCount == shard;
+}
+
+void GetBitfieldUnit(const IrField& field, uint64_t *unitOffset, uint32_t *unitSize)
+{
+    const uint64_t offset = field.offset;
+
+    // a bitfield has no address, it is located by the storage unit of
+    // its declared type and the bits within it. packed records may let
+    // a bitfield cross that unit, it then gets the smallest unit that
+    // holds it from its first byte on.
+    *unitSize = std::max(field.size, 1u);
+    *unitOffset = offset / (*unitSize * 8) * *unitSize;
+
+    if (offset + field.bitWidth > (*unitOffset + *unitSize) * 8)
+    {
+        *unitOffset = offset / 8;
+        *unitSize = 1;
+        while (*unitSize < 8 && offset + field.bitWidth > (*unitOffset + *unitSize) * 8)
+        {
+            *unitSize *= 2;
+        }
+    }
+}
+
+std::string FragmentBuilder::GetSource()
+{
+    std::string source;
+    WriteSource(
+        [&source](const char *data, size_t size) {
+            source.append(data, size);
+        },
+        0,
+        1
+    );
+
+    return source;
+}
+
+std::string GetNumberTypeName(NumberType type)
+{
+    const char *prefix = type.isEnum ? "ENUM_" : "";
+
+    switch (type.kind)
+    {
+        case NumberKind_Bool:
+            return "CL_NUMBER_BOOL";
+        case NumberKind_Signed:
+            return fmt::format("CL_NUMBER_{}INT{}", prefix, type.size * 8);
+        case NumberKind_Unsigned:
+            return fmt::format("CL_NUMBER_{}UINT{}", prefix, type.size * 8);
+        case NumberKind_Float:
+            return fmt::format("CL_NUMBER_FLOAT{}", type.size * 8);
+        case NumberKind_LongDouble:
+            return "CL_NUMBER_LONG_DOUBLE";
+        default:
+            return "CL_NUMBER_NONE";
+    }
+}
+
+void FragmentBuilder::BeginObject(const IrRecord& record)
+{
+    assert(!inObject);
+
+    inObject = true;
+    isUnion = record.isUnion;
+    currentObjectType = record.type;
+    currentObjectDisplayName = record.name;
+    currentObjectUSR = *record.usr ? record.usr : record.name;
+
+    prevFieldIsNumber = false;
+    prevFieldDisplayName.clear();
+}
+
+void FragmentBuilder::EndObject()
+{
+    assert(inObject);
+
+    ObjectFragment object;
+    object.usr = currentObjectUSR;
+    object.name = currentObjectDisplayName;
+    object.source.assign(sourceBuffer.data(), sourceBuffer.size());
+    object.header.assign(headerBuffer.data(), headerBuffer.size());
+    object.bench.assign(benchBuffer.data(), benchBuffer.size());
+    object.names = std::move(pooledNames);
+    pooledNames.clear();
+
+    if (!includedFiles.empty())
+    {
+        object.inputs.push_back(includedFiles.back());
+    }
+
+    AddObject(std::move(object));
+    sourceBuffer.clear();
+    headerBuffer.clear();
+    benchBuffer.clear();
+
+    inObject = false;
+    isUnion = false;
+    currentObjectType.clear();
+    currentObjectDisplayName.clear();
+    currentObjectUSR.clear();
+    prevFieldIsNumber = false;
+    prevFieldDisplayName.clear();
+    currentFieldNames.clear();
+}
+
+void FragmentBuilder::BeginField(const IrField& field, bool isNumber)
+{
+    assert(inObject);
+    prevFieldIsNumber = isNumber;
+    prevFieldDisplayName = field.name;
+    currentFieldNames.push_back(prevFieldDisplayName);
+}
+
+bool FragmentBuilder::IsFlexibleArray() const
+{
+    static const char *keywordStr[] = {
+        "len",
+        "num",
+        "size",
+    };
+
+    if (prevFieldIsNumber)
+    {
+        for (const auto kw : keywordStr)
+        {
+            if (boost::algorithm::iends_with(
+                prevFieldDisplayName,
+                kw))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// an explicit clcli:length= annotation wins over the name heuristic,
+// empty for a fixed array. call before BeginField() of the array.
+// pointers take the annotation only, see BuilderV1::DefinePointerField.
+std::string FragmentBuilder::GetLengthField(const IrField& field) const
+{
+    if (field.lengthField)
+    {
+        return field.lengthField;
+    }
+
+    return IsFlexibleArray() ? prevFieldDisplayName : std::string();
+}
+
+void FragmentBuilder::LineInfo(const IrLocation& location, fmt::memory_buffer *buffer)
+{
+    fmt::format_to(
+        std::back_inserter(*buffer),
+        "// line {}:{}:{}\n",
+        StripPrefixDot(location.file),
+        location.line,
+        location.column
+    );
+}
+
+void FragmentBuilder::Include(std::string name)
+{
+    includedFiles.push_back(
+        StripPrefixDot(name)
+    );
+}
+
+void FragmentBuilder::AddObject(ObjectFragment object)
+{
+    auto it = objectIndexes.find(object.usr);
+    if (it == objectIndexes.end())
+    {
+        objectIndexes[object.usr] = objects.size();
+        objects.push_back(std::move(object));
+        return;
+    }
+
+    auto& inputs = objects[it->second].inputs;
+    for (auto& input : object.inputs)
+    {
+        if (std::find(inputs.begin(), inputs.end(), input) == inputs.end())
+        {
+            inputs.push_back(std::move(input));
+        }
+    }
+}
+
+void FragmentBuilder::Merge(Builder *other)
+{
+    assert(!inObject);
+
+    auto builder = static_cast<FragmentBuilder *>(other);
+    assert(!builder->inObject);
+
+    includedFiles.insert(
+        includedFiles.end(),
+        builder->includedFiles.begin(),
+        builder->includedFiles.end()
+    );
+
+    for (const auto& object : builder->objects)
+    {
+        AddObject(object);
+    }
+}
+
+static void SaveChunk(std::string *data, const char *chunk, size_t size)
+{
+    data->append(fmt::format("{}\n", size));
+    data->append(chunk, size);
+}
+
+static bool LoadNumber(const std::string& data, size_t *pos, size_t *value)
+{
+    const size_t newline = data.find('\n', *pos);
+    if (newline == std::string::npos)
+    {
+        return false;
+    }
+
+    char *end = nullptr;
+    *value = strtoull(data.c_str() + *pos, &end, 10);
+    if (end != data.c_str() + newline)
+    {
+        return false;
+    }
+
+    *pos = newline + 1;
+    return true;
+}
+
+static bool LoadChunk(const std::string& data, size_t *pos, std::string *chunk)
+{
+    size_t size = 0;
+    if (!LoadNumber(data, pos, &size)
+        || size > data.size() - *pos)
+    {
+        return false;
+    }
+
+    chunk->assign(data, *pos, size);
+    *pos += size;
+    return true;
+}
+
+void FragmentBuilder::Save(std::string *data)
+{
+    assert(!inObject);
+
+    data->append(fmt::format("{}\n", includedFiles.size()));
+    for (const auto& includedFile : includedFiles)
+    {
+        SaveChunk(data, includedFile.data(), includedFile.size());
+    }
+
+    data->append(fmt::format("{}\n", objects.size()));
+    for (const auto& object : objects)
+    {
+        SaveChunk(data, object.usr.data(), object.usr.size());
+        SaveChunk(data, object.name.data(), object.name.size());
+        SaveChunk(data, object.source.data(), object.source.size());
+        SaveChunk(data, object.header.data(), object.header.size());
+        SaveChunk(data, object.bench.data(), object.bench.size());
+
+        data->append(fmt::format("{}\n", object.inputs.size()));
+        for (const auto& input : object.inputs)
+        {
+            SaveChunk(data, input.data(), input.size());
+        }
+
+        data->append(fmt::format("{}\n", object.names.size()));
+        for (const auto& name : object.names)
+        {
+            SaveChunk(data, name.data(), name.size());
+        }
+    }
+}
+
+static bool LoadChunks(
+    const std::string& data,
+    size_t *pos,
+    std::vector<std::string> *chunks)
+{
+    size_t count = 0;
+    if (!LoadNumber(data, pos, &count)
+        || count > data.size())
+    {
+        return false;
+    }
+
+    chunks->resize(count);
+    for (auto& chunk : *chunks)
+    {
+        if (!LoadChunk(data, pos, &chunk))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool FragmentBuilder::Load(const std::string& data)
+{
+    assert(!inObject);
+
+    size_t pos = 0;
+    std::vector<std::string> files;
+    if (!LoadChunks(data, &pos, &files))
+    {
+        return false;
+    }
+
+    size_t count = 0;
+    if (!LoadNumber(data, &pos, &count)
+        || count > data.size())
+    {
+        return false;
+    }
+
+    std::vector<ObjectFragment> fragments(count);
+    for (auto& object : fragments)
+    {
+        if (!LoadChunk(data, &pos, &object.usr)
+            || !LoadChunk(data, &pos, &object.name)
+            || !LoadChunk(data, &pos, &object.source)
+            || !LoadChunk(data, &pos, &object.header)
+            || !LoadChunk(data, &pos, &object.bench)
+            || !LoadChunks(data, &pos, &object.inputs)
+            || !LoadChunks(data, &pos, &object.names))
+        {
+            return false;
+        }
+    }
+
+    if (pos != data.size())
+    {
+        return false;
+    }
+
+    includedFiles.insert(includedFiles.end(), files.begin(), files.end());
+    for (auto& object : fragments)
+    {
+        AddObject(std::move(object));
+    }
+
+    return true;
+}
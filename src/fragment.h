@@ -0,0 +1,75 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+
+#include "builder.h"
+
+// the emitted code of one record, keyed by its USR so a record that is
+// reachable from several inputs is only generated once per run.
+struct ObjectFragment
+{
+    std::string usr;
+    std::string name;
+    std::string source;
+    std::string header;
+    std::string bench;
+    std::vector<std::string> inputs;
+
+    // field names the source refers to through the name pool of the
+    // output file it is written to.
+    std::vector<std::string> names;
+};
+
+// bookkeeping shared by every backend: records are emitted into
+// sourceBuffer/headerBuffer/benchBuffer between BeginObject() and EndObject(), and
+// kept as fragments that merge, deduplicate and cache the same way.
+struct FragmentBuilder : public Builder
+{
+    void Include(std::string header) override;
+    void Merge(Builder *other) override;
+
+    void Save(std::string *data) override;
+    bool Load(const std::string& data) override;
+
+    std::string GetSource() override;
+
+    void BeginObject(const IrRecord& record);
+    void EndObject();
+    void BeginField(const IrField& field, bool isNumber);
+    bool IsFlexibleArray() const;
+    std::string GetLengthField(const IrField& field) const;
+
+    void AddObject(ObjectFragment object);
+    void LineInfo(const IrLocation& location, fmt::memory_buffer *buffer);
+
+    std::string currentObjectType;
+    std::string currentObjectDisplayName;
+    std::string currentObjectUSR;
+
+    bool isUnion = false;
+    bool inObject = false;
+    fmt::memory_buffer sourceBuffer;
+    fmt::memory_buffer headerBuffer;
+    fmt::memory_buffer benchBuffer;
+
+    bool prevFieldIsNumber = false;
+    std::string prevFieldDisplayName;
+    std::vector<std::string> currentFieldNames;
+    std::vector<std::string> pooledNames;
+
+    // the first include is the generated header itself, see
+    // NewOutputBuilder, the inputs follow.
+    std::vector<std::string> includedFiles;
+    std::vector<ObjectFragment> objects;
+    std::map<std::string, size_t> objectIndexes;
+};
+
+std::string StripPrefixDot(const std::string& path);
+bool IsInShard(const ObjectFragment& object, uint32_t shard, uint32_t shardCount);
+std::string GetNumberTypeName(NumberType type);
+void GetBitfieldUnit(const IrField& field, uint64_t *unitOffset, uint32_t *unitSize);
+
+Builder *NewConstexprBuilder();
@@ -0,0 +1,195 @@
+#include <cassert>
+#include <algorithm>
+#include <unordered_map>
+
+#include "ir.h"
+#include "builder.h"
+#include "util.h"
+
+// large enough for the records of a typical header in a single block.
+static const size_t kIrBlockSize = 64 * 1024;
+
+size_t IrArena::StringHash::operator()(const char *str) const
+{
+    return HashBytes(str, strlen(str));
+}
+
+void *IrArena::Allocate(size_t size, size_t align)
+{
+    size_t offset = (blockUsed + align - 1) & ~(align - 1);
+
+    if (blocks.empty() || offset + size > blockSize)
+    {
+        blockSize = std::max(kIrBlockSize, size + align);
+        blocks.emplace_back(new char[blockSize]);
+
+        // new[] returns storage aligned for any fundamental type.
+        offset = 0;
+    }
+
+    blockUsed = offset + size;
+    return blocks.back().get() + offset;
+}
+
+const char *IrArena::Intern(const char *str)
+{
+    auto it = strings.find(str);
+    if (it != strings.end())
+    {
+        return *it;
+    }
+
+    const size_t size = strlen(str) + 1;
+    char *copy = static_cast<char *>(Allocate(size, 1));
+    memcpy(copy, str, size);
+
+    strings.insert(copy);
+    return copy;
+}
+
+void AddIrRecord(IrUnit *unit, IrRecord *record)
+{
+    *unit->recordsTail = record;
+    unit->recordsTail = &record->next;
+}
+
+void AddIrField(IrRecord *record, IrField *field)
+{
+    *record->fieldsTail = field;
+    record->fieldsTail = &field->next;
+    ++ record->fieldCount;
+}
+
+// keeps the records reachable from the roots through the element
+// records of their fields, every other record is dropped from the unit.
+// a root matches a record by name or by type, e.g. "Foo", "struct Foo"
+// or "ns::Foo". returns the number of records dropped, matchedRoots
+// gets the roots that matched a record set.
+uint32_t PruneIrUnit(
+    IrUnit *unit,
+    const std::vector<std::string>& roots,
+    std::vector<bool> *matchedRoots)
+{
+    if (matchedRoots)
+    {
+        matchedRoots->resize(roots.size());
+    }
+
+    std::unordered_map<const char *, std::vector<IrRecord *>> recordsByName;
+    std::unordered_set<const IrRecord *> reachable;
+    std::vector<const IrRecord *> pending;
+
+    for (auto record = unit->records; record; record = record->next)
+    {
+        recordsByName[record->name].push_back(record);
+
+        for (size_t i = 0; i < roots.size(); ++ i)
+        {
+            if (roots[i] == record->name || roots[i] == record->type)
+            {
+                if (matchedRoots)
+                {
+                    (*matchedRoots)[i] = true;
+                }
+
+                if (reachable.insert(record).second)
+                {
+                    pending.push_back(record);
+                }
+            }
+        }
+    }
+
+    // element names are interned in the same arena as record names.
+    while (!pending.empty())
+    {
+        auto record = pending.back();
+        pending.pop_back();
+
+        for (auto field = record->fields; field; field = field->next)
+        {
+            auto it = field->elementName
+                ? recordsByName.find(field->elementName)
+                : recordsByName.end();
+            if (it == recordsByName.end())
+            {
+                continue;
+            }
+
+            for (auto element : it->second)
+            {
+                if (reachable.insert(element).second)
+                {
+                    pending.push_back(element);
+                }
+            }
+        }
+    }
+
+    uint32_t pruned = 0;
+    auto record = unit->records;
+    unit->records = nullptr;
+    unit->recordsTail = &unit->records;
+
+    while (record)
+    {
+        auto next = record->next;
+        record->next = nullptr;
+
+        if (reachable.count(record))
+        {
+            AddIrRecord(unit, record);
+        }
+        else
+        {
+            ++ pruned;
+        }
+
+        record = next;
+    }
+
+    return pruned;
+}
+
+void AddIrMember(IrRecord *record, IrMember *member)
+{
+    *record->membersTail = member;
+    record->membersTail = &member->next;
+}
+
+void EmitIrUnit(Builder *builder, const IrUnit& unit)
+{
+    for (const auto include : unit.includes)
+    {
+        builder->Include(include);
+    }
+
+    for (auto record = unit.records; record; record = record->next)
+    {
+        builder->EnterObject(*record);
+
+        for (auto field = record->fields; field; field = field->next)
+        {
+            switch (field->kind)
+            {
+                case IrFieldKind_Number:
+                    builder->DefineNumberField(*field);
+                    break;
+                case IrFieldKind_Array:
+                    builder->DefineArrayField(*field);
+                    break;
+                case IrFieldKind_Object:
+                    builder->DefineObjectField(*field);
+                    break;
+                case IrFieldKind_Pointer:
+                    builder->DefinePointerField(*field);
+                    break;
+                case IrFieldKind_Container:
+                    builder->DefineContainerField(*field);
+                    break;
+            }
+        }
+
+        builder->LeaveObject();
+    }
+}
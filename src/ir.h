@@ -0,0 +1,217 @@
+#pragma once
+
+#include <new>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_set>
+
+enum NumberKind
+{
+    NumberKind_None,
+    NumberKind_Bool,
+    NumberKind_Signed,
+    NumberKind_Unsigned,
+    NumberKind_Float,
+    NumberKind_LongDouble,
+};
+
+// the canonical scalar kind of a field or array element, enums carry
+// the kind of their underlying integer type.
+struct NumberType
+{
+    NumberKind kind = NumberKind_None;
+    bool isEnum = false;
+    uint32_t size = 0;
+};
+
+// a bump allocator for the records of one translation unit, nothing is
+// freed before the arena itself. strings are interned, so equal names
+// share storage and compare by pointer.
+struct IrArena
+{
+    IrArena() = default;
+    IrArena(const IrArena&) = delete;
+    IrArena& operator=(const IrArena&) = delete;
+
+    void *Allocate(size_t size, size_t align);
+    const char *Intern(const char *str);
+
+    template <typename T>
+    T *New()
+    {
+        return new (Allocate(sizeof(T), alignof(T))) T();
+    }
+
+private:
+    struct StringHash
+    {
+        size_t operator()(const char *str) const;
+    };
+
+    struct StringEqual
+    {
+        bool operator()(const char *a, const char *b) const
+        {
+            return !strcmp(a, b);
+        }
+    };
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockUsed = 0;
+    size_t blockSize = 0;
+    std::unordered_set<const char *, StringHash, StringEqual> strings;
+};
+
+struct IrLocation
+{
+    const char *file = "";
+    uint32_t line = 0;
+    uint32_t column = 0;
+};
+
+enum IrFieldKind
+{
+    IrFieldKind_Number,
+    IrFieldKind_Array,
+    IrFieldKind_Object,
+    IrFieldKind_Pointer,
+    IrFieldKind_Container,
+};
+
+// the standard library type of a container field, C++ only.
+enum IrContainer
+{
+    IrContainer_Vector,
+    IrContainer_Array,
+    IrContainer_String,
+};
+
+// wire encoding requested by a clcli:varint/zigzag/fixed/delta
+// annotation, Default leaves the choice to the runtime. a delta scalar
+// is relative to the same field of the previous value in the stream, a
+// delta array to its previous element.
+enum IrEncoding
+{
+    IrEncoding_Default,
+    IrEncoding_Varint,
+    IrEncoding_Zigzag,
+    IrEncoding_Fixed,
+    IrEncoding_Delta,
+};
+
+struct IrField
+{
+    IrFieldKind kind = IrFieldKind_Number;
+    const char *name = "";
+
+    // the scalar of a number field, the innermost scalar of an array or
+    // the pointee of a pointer.
+    NumberType number;
+
+    // the record of an object field, object array or record pointer,
+    // nullptr for scalars.
+    const char *elementName = nullptr;
+    bool elementIsUnion = false;
+
+    // the element record of an object array is flat, see IrRecord.
+    bool elementIsFlat = false;
+
+    // a pointer to plain char, a NUL-terminated string unless a length
+    // field precedes it.
+    bool pointeeIsChar = false;
+
+    // a std::vector, std::array or std::string member, its element is
+    // described by number or elementName like that of an array.
+    IrContainer container = IrContainer_Vector;
+
+    // offset in bits, fields of a base class are relative to the base and
+    // are not direct members of the record.
+    long long offset = -1;
+    bool isBitField = false;
+    bool isDirect = true;
+
+    // storage of the declared type in bytes, 0 for incomplete arrays.
+    uint32_t size = 0;
+    uint32_t align = 0;
+    uint32_t bitWidth = 0;
+
+    // hints from clcli: annotations. an explicit length field replaces
+    // the name heuristic and maxCount bounds the element count of an
+    // array, pointer array, string or container.
+    IrEncoding encoding = IrEncoding_Default;
+    const char *lengthField = nullptr;
+    uint32_t maxCount = 0;
+
+    IrField *next = nullptr;
+};
+
+// a direct member as declared, including the ones no backend emits,
+// e.g. function pointers, unnamed bitfields or anonymous records. only
+// collected for the layout report, offsets in bits.
+struct IrMember
+{
+    const char *name = "";
+    long long offset = -1;
+    bool isBitField = false;
+    uint32_t size = 0;
+    uint32_t align = 0;
+    uint32_t bitWidth = 0;
+
+    IrMember *next = nullptr;
+};
+
+struct IrRecord
+{
+    const char *usr = "";
+    const char *name = "";
+    const char *type = "";
+    bool isUnion = false;
+    bool hasBases = false;
+    IrLocation location;
+
+    // every member is a direct, whole scalar of 1, 2, 4 or 8 bytes, so
+    // an array of the record can be transposed into one column per
+    // member.
+    bool isFlat = false;
+
+    uint64_t size = 0;
+    uint32_t align = 0;
+
+    IrField *fields = nullptr;
+    IrField **fieldsTail = &fields;
+    uint32_t fieldCount = 0;
+
+    IrMember *members = nullptr;
+    IrMember **membersTail = &members;
+
+    IrRecord *next = nullptr;
+};
+
+// everything a backend needs from one input, built in a single libclang
+// pass so the translation unit can be released before emission.
+struct IrUnit
+{
+    IrArena arena;
+    std::vector<const char *> includes;
+
+    // set before the visit to collect IrRecord::members as well.
+    bool withMembers = false;
+
+    IrRecord *records = nullptr;
+    IrRecord **recordsTail = &records;
+};
+
+struct Builder;
+
+void AddIrRecord(IrUnit *unit, IrRecord *record);
+void AddIrField(IrRecord *record, IrField *field);
+void AddIrMember(IrRecord *record, IrMember *member);
+void EmitIrUnit(Builder *builder, const IrUnit& unit);
+uint32_t PruneIrUnit(
+    IrUnit *unit,
+    const std::vector<std::string>& roots,
+    std::vector<bool> *matchedRoots = nullptr);
@@ -0,0 +1,376 @@
+#include <cstdio>
+#include <algorithm>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include "layout.h"
+#include "util.h"
+#include "fragment.h"
+
+static const uint64_t kCacheLineSize = 64;
+
+static uint64_t AlignTo(uint64_t value, uint64_t align)
+{
+    return align ? (value + align - 1) / align * align : value;
+}
+
+// anonymous records and unnamed bitfields still take up space.
+static std::string MemberName(const IrMember& member)
+{
+    return *member.name ? member.name : "(anonymous)";
+}
+
+// the tightest order is the classic one: most aligned first, larger
+// fields first among equals, declaration order otherwise.
+static void SuggestOrder(
+    const std::vector<const IrMember *>& members,
+    uint64_t start,
+    RecordLayout *layout)
+{
+    std::vector<const IrMember *> order = members;
+    std::stable_sort(
+        order.begin(),
+        order.end(),
+        [](const IrMember *a, const IrMember *b) {
+            if (a->align != b->align)
+            {
+                return a->align > b->align;
+            }
+
+            return a->size > b->size;
+        }
+    );
+
+    uint64_t offset = start;
+    for (const auto member : order)
+    {
+        offset = AlignTo(offset, member->align) + member->size;
+    }
+
+    const uint64_t size = AlignTo(offset, layout->align);
+    if (size >= layout->size)
+    {
+        return;
+    }
+
+    for (const auto member : order)
+    {
+        layout->suggestedOrder.push_back(MemberName(*member));
+    }
+
+    layout->suggestedSize = size;
+}
+
+static bool AnalyzeRecord(const IrRecord& record, RecordLayout *layout)
+{
+    // union members overlap by design, and incomplete or dependent
+    // records report no layout at all. the layout is taken from every
+    // declared member, not only the fields with a wire form.
+    if (record.isUnion || !record.size || !record.members)
+    {
+        return false;
+    }
+
+    layout->usr = *record.usr ? record.usr : record.name;
+    layout->name = record.name;
+    layout->file = StripPrefixDot(record.location.file);
+    layout->line = record.location.line;
+    layout->size = record.size;
+    layout->align = record.align;
+
+    std::vector<const IrMember *> members;
+    bool canReorder = !record.hasBases;
+
+    for (auto member = record.members; member; member = member->next)
+    {
+        if (member->offset < 0)
+        {
+            continue;
+        }
+
+        members.push_back(member);
+        canReorder = canReorder && !member->isBitField && member->size;
+    }
+
+    if (members.empty())
+    {
+        return false;
+    }
+
+    std::stable_sort(
+        members.begin(),
+        members.end(),
+        [](const IrMember *a, const IrMember *b) {
+            return a->offset < b->offset;
+        }
+    );
+
+    // anything before the first member is a vtable pointer or a base,
+    // neither is padding.
+    const uint64_t start = members.front()->offset;
+    uint64_t end = start;
+    uint64_t used = 0;
+
+    for (size_t i = 0; i < members.size(); ++ i)
+    {
+        const auto member = members[i];
+        const uint64_t offset = member->offset;
+        const uint64_t bits = member->bitWidth;
+
+        if (offset / 8 > (end + 7) / 8)
+        {
+            LayoutHole hole;
+            hole.after = MemberName(*members[i - 1]);
+            hole.offset = (end + 7) / 8;
+            hole.size = offset / 8 - hole.offset;
+            layout->holes.push_back(hole);
+        }
+
+        if (bits && offset / 8 / kCacheLineSize != (offset + bits - 1) / 8 / kCacheLineSize)
+        {
+            layout->straddling.push_back(MemberName(*member));
+        }
+
+        used += bits;
+        end = std::max(end, offset + bits);
+    }
+
+    layout->tailPadding = record.size - std::min<uint64_t>((end + 7) / 8, record.size);
+    layout->padding = record.size - std::min<uint64_t>((used + 7) / 8 + start / 8, record.size);
+
+    if (canReorder)
+    {
+        SuggestOrder(members, start / 8, layout);
+    }
+
+    return true;
+}
+
+void AnalyzeLayout(const IrUnit& unit, InputLayout *layout)
+{
+    for (auto record = unit.records; record; record = record->next)
+    {
+        RecordLayout recordLayout;
+        if (AnalyzeRecord(*record, &recordLayout))
+        {
+            layout->records.push_back(std::move(recordLayout));
+        }
+    }
+}
+
+void DeduplicateLayouts(std::vector<InputLayout> *layouts)
+{
+    std::set<std::string> seen;
+
+    for (auto& layout : *layouts)
+    {
+        auto& records = layout.records;
+        records.erase(
+            std::remove_if(
+                records.begin(),
+                records.end(),
+                [&seen](const RecordLayout& record) {
+                    return !seen.insert(record.usr).second;
+                }),
+            records.end()
+        );
+    }
+}
+
+static uint64_t SavedBytes(const RecordLayout& record)
+{
+    return record.suggestedOrder.empty() ? 0 : record.size - record.suggestedSize;
+}
+
+static void PrintJsonLayoutReport(const std::vector<InputLayout>& layouts)
+{
+    fmt::memory_buffer buffer;
+    fmt::format_to(
+        std::back_inserter(buffer),
+        "{{\n"
+        "  \"cache_line\": {},\n"
+        "  \"inputs\": [",
+        kCacheLineSize
+    );
+
+    for (size_t i = 0; i < layouts.size(); ++ i)
+    {
+        const auto& layout = layouts[i];
+
+        uint64_t padding = 0, saved = 0;
+        for (const auto& record : layout.records)
+        {
+            padding += record.padding;
+            saved += SavedBytes(record);
+        }
+
+        fmt::format_to(
+            std::back_inserter(buffer),
+            "{}\n    {{\"input\": {}, \"padding\": {}, \"saved\": {}, \"records\": [",
+            i ? "," : "",
+            JsonString(layout.input),
+            padding,
+            saved
+        );
+
+        for (size_t j = 0; j < layout.records.size(); ++ j)
+        {
+            const auto& record = layout.records[j];
+
+            fmt::format_to(
+                std::back_inserter(buffer),
+                "{}\n      {{\"name\": {}, \"file\": {}, \"line\": {}, \"size\": {}, \"align\": {}, "
+                "\"padding\": {}, \"tail_padding\": {}, \"holes\": [",
+                j ? "," : "",
+                JsonString(record.name),
+                JsonString(record.file),
+                record.line,
+                record.size,
+                record.align,
+                record.padding,
+                record.tailPadding
+            );
+
+            for (size_t k = 0; k < record.holes.size(); ++ k)
+            {
+                fmt::format_to(
+                    std::back_inserter(buffer),
+                    "{}{{\"after\": {}, \"offset\": {}, \"size\": {}}}",
+                    k ? ", " : "",
+                    JsonString(record.holes[k].after),
+                    record.holes[k].offset,
+                    record.holes[k].size
+                );
+            }
+
+            fmt::format_to(
+                std::back_inserter(buffer),
+                "], \"straddling\": ["
+            );
+
+            for (size_t k = 0; k < record.straddling.size(); ++ k)
+            {
+                fmt::format_to(
+                    std::back_inserter(buffer),
+                    "{}{}",
+                    k ? ", " : "",
+                    JsonString(record.straddling[k])
+                );
+            }
+
+            fmt::format_to(
+                std::back_inserter(buffer),
+                "], \"suggested_order\": ["
+            );
+
+            for (size_t k = 0; k < record.suggestedOrder.size(); ++ k)
+            {
+                fmt::format_to(
+                    std::back_inserter(buffer),
+                    "{}{}",
+                    k ? ", " : "",
+                    JsonString(record.suggestedOrder[k])
+                );
+            }
+
+            fmt::format_to(
+                std::back_inserter(buffer),
+                "], \"suggested_size\": {}, \"saved\": {}}}",
+                record.suggestedOrder.empty() ? record.size : record.suggestedSize,
+                SavedBytes(record)
+            );
+        }
+
+        fmt::format_to(
+            std::back_inserter(buffer),
+            "{}]}}",
+            layout.records.empty() ? "" : "\n    "
+        );
+    }
+
+    fmt::format_to(
+        std::back_inserter(buffer),
+        "\n  ]\n"
+        "}}\n"
+    );
+
+    fwrite(buffer.data(), buffer.size(), 1, stdout);
+}
+
+static void PrintTextLayoutReport(const std::vector<InputLayout>& layouts)
+{
+    for (const auto& layout : layouts)
+    {
+        uint64_t padding = 0, saved = 0;
+        for (const auto& record : layout.records)
+        {
+            padding += record.padding;
+            saved += SavedBytes(record);
+        }
+
+        fmt::print(
+            "{}: {} records, {} bytes padding, {} bytes saved by reordering\n",
+            layout.input,
+            layout.records.size(),
+            padding,
+            saved);
+
+        for (const auto& record : layout.records)
+        {
+            if (!record.padding && record.straddling.empty())
+            {
+                continue;
+            }
+
+            fmt::print(
+                "  {} ({}:{}): size {}, align {}, padding {}, tail {}\n",
+                record.name,
+                record.file,
+                record.line,
+                record.size,
+                record.align,
+                record.padding,
+                record.tailPadding);
+
+            for (const auto& hole : record.holes)
+            {
+                fmt::print(
+                    "    hole of {} bytes at {} after {}\n",
+                    hole.size,
+                    hole.offset,
+                    hole.after);
+            }
+
+            for (const auto& field : record.straddling)
+            {
+                fmt::print(
+                    "    {} straddles a {} byte cache line\n",
+                    field,
+                    kCacheLineSize);
+            }
+
+            if (!record.suggestedOrder.empty())
+            {
+                fmt::print(
+                    "    reorder as {} to save {} bytes\n",
+                    fmt::join(record.suggestedOrder, ", "),
+                    SavedBytes(record));
+            }
+        }
+    }
+}
+
+void PrintLayoutReport(const std::vector<InputLayout>& layouts, ReportFormat format)
+{
+    switch (format)
+    {
+        case ReportFormat_Text:
+            PrintTextLayoutReport(layouts);
+            return;
+        case ReportFormat_Json:
+            PrintJsonLayoutReport(layouts);
+            return;
+        default:
+            return;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "ir.h"
+#include "stats.h"
+
+// a gap in the record, offsets and sizes in bytes.
+struct LayoutHole
+{
+    std::string after;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+struct RecordLayout
+{
+    std::string usr;
+    std::string name;
+    std::string file;
+    uint32_t line = 0;
+    uint64_t size = 0;
+    uint32_t align = 0;
+
+    uint64_t padding = 0;
+    uint64_t tailPadding = 0;
+    std::vector<LayoutHole> holes;
+    std::vector<std::string> straddling;
+
+    // empty when the record cannot or need not be reordered.
+    std::vector<std::string> suggestedOrder;
+    uint64_t suggestedSize = 0;
+};
+
+struct InputLayout
+{
+    std::string input;
+    std::vector<RecordLayout> records;
+};
+
+void AnalyzeLayout(const IrUnit& unit, InputLayout *layout);
+
+// records seen by an earlier input are dropped, so a shared header is
+// only reported once, under the first input including it.
+void DeduplicateLayouts(std::vector<InputLayout> *layouts);
+void PrintLayoutReport(const std::vector<InputLayout>& layouts, ReportFormat format);
@@ -1,56 +1,65 @@
 #include <set>
+#include <algorithm>
+#include <atomic>
 #include <string>
+#include <cstring>
+#include <thread>
 #include <vector>
+#include <functional>
+#include <getopt.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <fmt/format.h>
 
+#include "clcli.h"
 #include "visit.h"
+#include "serve.h"
+#include "cache.h"
+#include "stats.h"
+#include "layout.h"
 #include "builder.h"
+#include "ir.h"
+#include "util.h"
 
-struct ClcliOptions
-{
-    bool isCpp = false;
-    std::string workdir = ".";
-    std::string standard = "";
-    std::string output = "messages";
-    std::vector<std::string> inputs;
-    std::vector<std::string> includeDirs;
-};
-
-void ProcessFile(
-    Builder *builder,
+void BuildClangArgs(
     struct ClcliOptions *options,
-    uint32_t inputPos)
+    bool isHeader,
+    std::vector<std::string> *storage,
+    std::vector<const char *> *clangArgs)
 {
-    std::vector<std::string> storage;
-    storage.reserve(10 + options->includeDirs.size());
+    storage->reserve(10 + options->includeDirs.size());
 
-    std::vector<const char *> clangArgs;
-
-    clangArgs.push_back("-x");
-    clangArgs.push_back(options->isCpp ? "c++" : "c");
+    clangArgs->push_back("-x");
+    if (isHeader)
+    {
+        clangArgs->push_back(options->isCpp ? "c++-header" : "c-header");
+    }
+    else
+    {
+        clangArgs->push_back(options->isCpp ? "c++" : "c");
+    }
 
     if (!options->standard.empty())
     {
-        storage.push_back(fmt::format("-std={}", options->standard));
-        clangArgs.push_back(storage.back().c_str());
+        storage->push_back(fmt::format("-std={}", options->standard));
+        clangArgs->push_back(storage->back().c_str());
     }
 
     for (const auto& includeDir : options->includeDirs)
     {
-        storage.push_back(fmt::format("-I{}", includeDir));
-        clangArgs.push_back(storage.back().c_str());
+        storage->push_back(fmt::format("-I{}", includeDir));
+        clangArgs->push_back(storage->back().c_str());
     }
 
-    CXIndex index = clang_createIndex(0, 0);
-    CXTranslationUnit translationUnit = clang_parseTranslationUnit(
-        index,
-        options->inputs[inputPos - 1].c_str(),
-        clangArgs.data(),
-        clangArgs.size(),
-        0, 0,
-        CXTranslationUnit_SkipFunctionBodies);
+    if (!isHeader && !options->pchFile.empty())
+    {
+        clangArgs->push_back("-include-pch");
+        clangArgs->push_back(options->pchFile.c_str());
+    }
+}
 
+uint32_t PrintDiagnostics(CXTranslationUnit translationUnit)
+{
     uint32_t flags = 0;
 
     size_t num  = clang_getNumDiagnostics(translationUnit);
@@ -77,15 +86,230 @@ void ProcessFile(
         clang_disposeString(message);
         clang_disposeDiagnostic(diagnostic);
 
-        flags |= severity;
+        flags |= 1u << severity;
+    }
+
+    return flags;
+}
+
+void BuildPrefixHeader(
+    CXIndex index,
+    struct ClcliOptions *options)
+{
+    if (options->prefixHeaders.empty())
+    {
+        return;
+    }
+
+    auto pchFile = fmt::format("{}.pch", options->output);
+    auto prefixName = fmt::format("{}.pch.h", options->output);
+
+    fmt::memory_buffer prefix;
+    for (const auto& prefixHeader : options->prefixHeaders)
+    {
+        fmt::format_to(
+            std::back_inserter(prefix),
+            "#include \"{}\"\n",
+            prefixHeader
+        );
+    }
+
+    CXUnsavedFile unsavedFile;
+    unsavedFile.Filename = prefixName.c_str();
+    unsavedFile.Contents = prefix.data();
+    unsavedFile.Length = prefix.size();
+
+    std::vector<std::string> storage;
+    std::vector<const char *> clangArgs;
+    BuildClangArgs(options, true, &storage, &clangArgs);
+
+    CXTranslationUnit translationUnit = clang_parseTranslationUnit(
+        index,
+        prefixName.c_str(),
+        clangArgs.data(),
+        clangArgs.size(),
+        &unsavedFile, 1,
+        CXTranslationUnit_SkipFunctionBodies
+            | CXTranslationUnit_Incomplete
+            | CXTranslationUnit_ForSerialization);
+
+    if (!translationUnit)
+    {
+        fmt::print(stderr, "{}: failed to parse prefix headers.\n", prefixName);
+        return;
+    }
+
+    const uint32_t flags = PrintDiagnostics(translationUnit);
+    const uint32_t errorFlags = (1u << CXDiagnostic_Error) | (1u << CXDiagnostic_Fatal);
+
+    // a broken PCH would only spread its errors to every input, so the
+    // inputs are parsed without it instead.
+    if (!(flags & errorFlags)
+        && !clang_saveTranslationUnit(
+            translationUnit,
+            pchFile.c_str(),
+            clang_defaultSaveOptions(translationUnit)))
+    {
+        options->pchFile = pchFile;
+    }
+    else
+    {
+        fmt::print(stderr, "{}: failed to precompile prefix headers.\n", pchFile);
+    }
+
+    clang_disposeTranslationUnit(translationUnit);
+}
+
+// what --root did to one input. records are named by USR, a header
+// shared by several inputs yields the same record in each of them.
+struct RootMatches
+{
+    std::vector<bool> roots;
+    std::vector<std::string> visited;
+    std::vector<std::string> kept;
+};
+
+bool ProcessFile(
+    Builder *builder,
+    CXIndex index,
+    struct ClcliOptions *options,
+    uint32_t inputPos,
+    std::vector<std::string> *dependencies,
+    RootMatches *rootMatches,
+    InputStats *stats,
+    InputLayout *layout)
+{
+    std::vector<std::string> storage;
+    std::vector<const char *> clangArgs;
+    BuildClangArgs(options, false, &storage, &clangArgs);
+
+    auto timer = StartTimer();
+    CXTranslationUnit translationUnit = clang_parseTranslationUnit(
+        index,
+        options->inputs[inputPos - 1].c_str(),
+        clangArgs.data(),
+        clangArgs.size(),
+        0, 0,
+        CXTranslationUnit_SkipFunctionBodies);
+
+    ++ stats->visit.clangCalls;
+    StopTimer(timer, &stats->phases[StatsPhase_Parse]);
+
+    if (!translationUnit)
+    {
+        fmt::print(stderr, "{}: failed to parse.\n", options->inputs[inputPos - 1]);
+        return false;
     }
 
+    timer = StartTimer();
+    PrintDiagnostics(translationUnit);
+    StopTimer(timer, &stats->phases[StatsPhase_Diagnostics]);
+
+    // the IR holds everything the backends need, the translation unit
+    // is released before any code is emitted.
+    timer = StartTimer();
+    IrUnit unit;
+    unit.withMembers = layout != nullptr;
+
+    std::vector<std::string> inclusions;
     VisitTranslationUnit(
-        builder, 
-        translationUnit);
+        &unit, 
+        translationUnit,
+        &inclusions,
+        &stats->visit);
 
     clang_disposeTranslationUnit(translationUnit);
-    clang_disposeIndex(index);
+
+    if (!options->roots.empty())
+    {
+        for (auto record = unit.records; record; record = record->next)
+        {
+            rootMatches->visited.push_back(record->usr);
+        }
+
+        stats->visit.pruned += PruneIrUnit(&unit, options->roots, &rootMatches->roots);
+
+        for (auto record = unit.records; record; record = record->next)
+        {
+            rootMatches->kept.push_back(record->usr);
+        }
+    }
+
+    EmitIrUnit(builder, unit);
+
+    if (layout)
+    {
+        AnalyzeLayout(unit, layout);
+    }
+    StopTimer(timer, &stats->phases[StatsPhase_Visit]);
+
+    // the PCH prefix is an in-memory file, only real files are tracked.
+    for (auto& inclusion : inclusions)
+    {
+        if (!access(inclusion.c_str(), R_OK))
+        {
+            dependencies->push_back(std::move(inclusion));
+        }
+    }
+
+    return true;
+}
+
+uint64_t HashClangArgs(struct ClcliOptions *options)
+{
+    std::vector<std::string> storage;
+    std::vector<const char *> clangArgs;
+    BuildClangArgs(options, false, &storage, &clangArgs);
+
+    uint64_t hash = HashBytes(&options->backend, sizeof(options->backend));
+
+    // cached fragments are only valid for the generator that emitted
+    // them, a rebuilt clcli binary starts over with a fresh key.
+    struct stat self;
+    if (!stat("/proc/self/exe", &self))
+    {
+        hash = HashBytes(&self.st_size, sizeof(self.st_size), hash);
+        hash = HashBytes(&self.st_mtime, sizeof(self.st_mtime), hash);
+    }
+
+    hash = HashBytes(&options->builderFlags, sizeof(options->builderFlags), hash);
+    hash = HashBytes(&options->fieldProfile.hash, sizeof(options->fieldProfile.hash), hash);
+    for (const auto clangArg : clangArgs)
+    {
+        hash = HashBytes(clangArg, strlen(clangArg) + 1, hash);
+    }
+
+    for (const auto& prefixHeader : options->prefixHeaders)
+    {
+        hash = HashBytes(prefixHeader.c_str(), prefixHeader.size() + 1, hash);
+    }
+
+    // roots are hashed apart from the prefix headers, so the two lists
+    // cannot trade entries and keep the key.
+    hash = HashBytes("--root", 7, hash);
+    for (const auto& root : options->roots)
+    {
+        hash = HashBytes(root.c_str(), root.size() + 1, hash);
+    }
+
+    return hash;
+}
+
+bool ParseReportFormat(const char *name, ReportFormat *format)
+{
+    if (!name || !strcmp(name, "text"))
+    {
+        *format = ReportFormat_Text;
+        return true;
+    }
+
+    if (!strcmp(name, "json"))
+    {
+        *format = ReportFormat_Json;
+        return true;
+    }
+
+    return false;
 }
 
 bool ParseOptions(
@@ -93,8 +317,26 @@ bool ParseOptions(
     int argc,
     char *argv[])
 {
+    static const struct option longOptions[] = {
+        {"jobs", required_argument, nullptr, 'j'},
+        {"prefix-header", required_argument, nullptr, 'p'},
+        {"cache", required_argument, nullptr, 'c'},
+        {"depfile", required_argument, nullptr, 'd'},
+        {"serve", no_argument, nullptr, 'S'},
+        {"backend", required_argument, nullptr, 'b'},
+        {"codec", no_argument, nullptr, 'E'},
+        {"bench", no_argument, nullptr, 'B'},
+        {"soa", no_argument, nullptr, 'A'},
+        {"profile", required_argument, nullptr, 'P'},
+        {"root", required_argument, nullptr, 'R'},
+        {"stats", optional_argument, nullptr, 'T'},
+        {"shards", required_argument, nullptr, 'K'},
+        {"layout-report", optional_argument, nullptr, 'L'},
+        {nullptr, 0, nullptr, 0},
+    };
+
     int opt;
-    while ((opt = getopt(argc, argv, "C:I:s:n:"))!= -1)
+    while ((opt = getopt_long(argc, argv, "C:I:s:n:j:p:c:d:b:", longOptions, nullptr))!= -1)
     {
         switch (opt)
         {
@@ -111,6 +353,68 @@ bool ParseOptions(
             case 'n':
                 options->output = optarg;
                 break;
+            case 'p':
+                options->prefixHeaders.push_back(optarg);
+                break;
+            case 'j':
+                options->jobs = std::max(atoi(optarg), 1);
+                break;
+            case 'c':
+                options->cacheDir = optarg;
+                break;
+            case 'd':
+                options->depfile = optarg;
+                break;
+            case 'S':
+                options->serve = true;
+                break;
+            case 'E':
+                options->builderFlags |= BuilderFlag_Codec;
+                break;
+            case 'B':
+                options->builderFlags |= BuilderFlag_Bench;
+                break;
+            case 'A':
+                options->builderFlags |= BuilderFlag_Soa;
+                break;
+            case 'P':
+                options->profile = optarg;
+                break;
+            case 'R':
+                options->roots.push_back(optarg);
+                break;
+            case 'K':
+                options->shards = std::max(atoi(optarg), 1);
+                break;
+            case 'T':
+                if (!ParseReportFormat(optarg, &options->stats))
+                {
+                    fmt::print(stderr, "{}: unknown stats format.\n", optarg);
+                    return false;
+                }
+                break;
+            case 'L':
+                if (!ParseReportFormat(optarg, &options->layoutReport))
+                {
+                    fmt::print(stderr, "{}: unknown layout report format.\n", optarg);
+                    return false;
+                }
+                break;
+            case 'b':
+                if (!strcmp(optarg, "constexpr"))
+                {
+                    options->backend = BuilderBackend_Constexpr;
+                }
+                else if (!strcmp(optarg, "columns"))
+                {
+                    options->backend = BuilderBackend_Columns;
+                }
+                else
+                {
+                    fmt::print(stderr, "{}: unknown backend.\n", optarg);
+                    return false;
+                }
+                break;
         }
     }
 
@@ -121,26 +425,463 @@ bool ParseOptions(
         );
     }
 
+    if (options->backend == BuilderBackend_Constexpr && !options->isCpp)
+    {
+        fmt::print(stderr, "constexpr: backend requires a c++ standard.\n");
+        return false;
+    }
+
+    if (options->stats == ReportFormat_Json && options->layoutReport == ReportFormat_Json)
+    {
+        fmt::print(stderr, "--stats=json and --layout-report=json both print to stdout.\n");
+        return false;
+    }
+
+    // clTraits<T>::Visit is the straight-line path of this backend.
+    if (options->backend == BuilderBackend_Constexpr && (options->builderFlags & BuilderFlag_Codec))
+    {
+        fmt::print(stderr, "constexpr: backend has no codec functions.\n");
+        return false;
+    }
+
+    if (options->backend == BuilderBackend_Constexpr && (options->builderFlags & BuilderFlag_Bench))
+    {
+        fmt::print(stderr, "constexpr: backend has no bench harness.\n");
+        return false;
+    }
+
+    // clTraits<T>::fields already lists every member offset for a
+    // template encoder to transpose.
+    if (options->backend == BuilderBackend_Constexpr && (options->builderFlags & BuilderFlag_Soa))
+    {
+        fmt::print(stderr, "constexpr: backend has no soa descriptors.\n");
+        return false;
+    }
+
+    // clTraits<T>::fields keeps the declaration order, the profile only
+    // reorders the column tables.
+    if (options->backend == BuilderBackend_Constexpr && !options->profile.empty())
+    {
+        fmt::print(stderr, "constexpr: backend has no column order to profile.\n");
+        return false;
+    }
+
     return !options->inputs.empty();
 }
 
-void Write(std::string path, const std::string& contents)
+void RunJobs(
+    uint32_t jobs,
+    uint32_t count,
+    const std::function<void (uint32_t)>& job)
+{
+    jobs = std::min(jobs, count);
+
+    if (jobs <= 1)
+    {
+        for (uint32_t i = 0; i < count; ++ i)
+        {
+            job(i);
+        }
+        return;
+    }
+
+    std::atomic<uint32_t> next(0);
+    std::vector<std::thread> workers;
+    workers.reserve(jobs);
+
+    for (uint32_t i = 0; i < jobs; ++ i)
+    {
+        workers.emplace_back([&]() {
+            for (;;)
+            {
+                const uint32_t pos = next.fetch_add(1);
+                if (pos >= count)
+                {
+                    return;
+                }
+
+                job(pos);
+            }
+        });
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+struct InputState
+{
+    Builder *builder = nullptr;
+    bool cached = false;
+    std::vector<std::string> dependencies;
+    RootMatches rootMatches;
+    InputLayout layout;
+};
+
+void ProcessFiles(
+    Builder *builder,
+    struct ClcliOptions *options,
+    std::vector<std::string> *dependencies,
+    Stats *stats,
+    std::vector<InputLayout> *layouts)
 {
-    FILE *f = fopen(path.c_str(), "wb+");
-    if (f)
+    const uint32_t count = options->inputs.size();
+    const uint64_t argsHash = HashClangArgs(options);
+
+    // every input gets its own builder, so workers never share state
+    // and merging them in input order reproduces the serial output.
+    std::vector<InputState> states(count);
+    std::vector<uint32_t> pending;
+
+    stats->inputs.resize(count);
+
+    for (uint32_t i = 0; i < count; ++ i)
+    {
+        auto& state = states[i];
+        state.builder = NewBuilder(options->backend, options->builderFlags, &options->fieldProfile);
+        stats->inputs[i].input = options->inputs[i];
+        state.layout.input = options->inputs[i];
+
+        // cached fragments carry no layout, reports need every input visited.
+        if (!options->cacheDir.empty() && options->layoutReport == ReportFormat_None)
+        {
+            auto timer = StartTimer();
+            state.cached = LoadCacheEntry(
+                options->cacheDir,
+                options->inputs[i],
+                argsHash,
+                state.builder,
+                &state.dependencies);
+
+            stats->inputs[i].cached = state.cached;
+            StopTimer(timer, &stats->inputs[i].phases[StatsPhase_Cache]);
+        }
+
+        if (!state.cached)
+        {
+            pending.push_back(i);
+        }
+    }
+
+    // libclang is only touched when some input actually changed.
+    if (!pending.empty())
     {
-        fwrite(
-            contents.data(),
-            contents.size(),
-            1,
-            f
+        // one index serves the whole run, the prefix headers are parsed
+        // once into a PCH that every input then loads instead of re-lexing.
+        CXIndex index = clang_createIndex(0, 0);
+
+        auto timer = StartTimer();
+        BuildPrefixHeader(index, options);
+        StopTimer(timer, &stats->phases[StatsPhase_Parse]);
+
+        RunJobs(
+            options->jobs,
+            pending.size(),
+            [&](uint32_t pos) {
+                const uint32_t inputPos = pending[pos];
+                auto& state = states[inputPos];
+                auto& inputStats = stats->inputs[inputPos];
+
+                const bool success = ProcessFile(
+                    state.builder,
+                    index,
+                    options,
+                    inputPos + 1,
+                    &state.dependencies,
+                    &state.rootMatches,
+                    &inputStats,
+                    options->layoutReport != ReportFormat_None ? &state.layout : nullptr);
+
+                if (success && !options->cacheDir.empty())
+                {
+                    auto timer = StartTimer();
+                    StoreCacheEntry(
+                        options->cacheDir,
+                        options->inputs[inputPos],
+                        argsHash,
+                        state.builder,
+                        state.dependencies);
+
+                    StopTimer(timer, &inputStats.phases[StatsPhase_Cache]);
+                }
+            }
         );
-        fclose(f);
+
+        clang_disposeIndex(index);
+
+        if (!options->pchFile.empty())
+        {
+            unlink(options->pchFile.c_str());
+        }
+    }
+
+    // a root that no input matches is almost always a typo. cached
+    // inputs carry no records to match, so the check only runs when
+    // every input was visited.
+    if (!options->roots.empty() && pending.size() == count)
+    {
+        for (size_t i = 0; i < options->roots.size(); ++ i)
+        {
+            const bool matched = std::any_of(
+                states.begin(),
+                states.end(),
+                [i](const InputState& state) {
+                    const auto& roots = state.rootMatches.roots;
+                    return i < roots.size() && roots[i];
+                }
+            );
+
+            if (!matched)
+            {
+                fmt::print(stderr, "{}: --root matches no record.\n", options->roots[i]);
+            }
+        }
+    }
+
+    auto timer = StartTimer();
+    std::set<std::string> seen;
+    for (auto& state : states)
+    {
+        builder->Merge(state.builder);
+        FreeBuilder(state.builder);
+        layouts->push_back(std::move(state.layout));
+
+        for (auto& dependency : state.dependencies)
+        {
+            if (seen.insert(dependency).second)
+            {
+                dependencies->push_back(std::move(dependency));
+            }
+        }
+    }
+
+    StopTimer(timer, &stats->phases[StatsPhase_Merge]);
+
+    // cached inputs were pruned when they were stored, only the inputs
+    // visited in this run are counted. a record kept by any input is
+    // emitted, so it does not count as pruned.
+    if (!options->roots.empty())
+    {
+        std::set<std::string> visited, kept;
+        for (const auto& state : states)
+        {
+            visited.insert(state.rootMatches.visited.begin(), state.rootMatches.visited.end());
+            kept.insert(state.rootMatches.kept.begin(), state.rootMatches.kept.end());
+        }
+
+        fmt::print(
+            stderr,
+            "--root: pruned {} of {} visited records.\n",
+            visited.size() - kept.size(),
+            visited.size());
+    }
+}
+
+bool WriteStream(
+    const std::string& path,
+    const std::function<void (const SourceSink&)>& produce,
+    uint64_t *size)
+{
+    // the output is streamed into a temporary file, then compared with
+    // the current one. unchanged outputs keep their mtime, so nothing
+    // downstream rebuilds.
+    auto tmpPath = fmt::format("{}.tmp", path);
+
+    FILE *f = fopen(tmpPath.c_str(), "wb");
+    if (!f)
+    {
+        fmt::print(stderr, "{}: failed to write.\n", path);
+        return false;
+    }
+
+    produce([f, size](const char *data, size_t n) {
+        fwrite(data, 1, n, f);
+
+        if (size)
+        {
+            *size += n;
+        }
+    });
+
+    fclose(f);
+
+    if (SameFileContents(tmpPath, path))
+    {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    rename(tmpPath.c_str(), path.c_str());
+    return true;
+}
+
+bool Write(const std::string& path, const std::string& contents, uint64_t *size = nullptr)
+{
+    return WriteStream(
+        path,
+        [&contents](const SourceSink& sink) {
+            sink(contents.data(), contents.size());
+        },
+        size
+    );
+}
+
+std::string EscapeDepfilePath(const std::string& path)
+{
+    std::string escaped;
+    for (const auto c : path)
+    {
+        if (c == ' ' || c == '#')
+        {
+            escaped.push_back('\\');
+        }
+        else if (c == '$')
+        {
+            escaped.push_back('$');
+        }
+
+        escaped.push_back(c);
+    }
+
+    return escaped;
+}
+
+std::string GetDepfile(
+    const std::vector<std::string>& targets,
+    const std::vector<std::string>& dependencies)
+{
+    fmt::memory_buffer depfile;
+
+    for (const auto& target : targets)
+    {
+        fmt::format_to(
+            std::back_inserter(depfile),
+            "{} ",
+            EscapeDepfilePath(target)
+        );
+    }
+
+    fmt::format_to(
+        std::back_inserter(depfile),
+        ":"
+    );
+
+    for (const auto& dependency : dependencies)
+    {
+        fmt::format_to(
+            std::back_inserter(depfile),
+            " \\\n  {}",
+            EscapeDepfilePath(dependency)
+        );
+    }
+
+    fmt::format_to(
+        std::back_inserter(depfile),
+        "\n"
+    );
+
+    return {
+        depfile.data(),
+        depfile.size(),
+    };
+}
+
+Builder *NewOutputBuilder(struct ClcliOptions *options)
+{
+    auto builder = NewBuilder(options->backend, options->builderFlags, &options->fieldProfile);
+    builder->Include(fmt::format("{}.h", options->output));
+    return builder;
+}
+
+void WriteOutputs(
+    struct ClcliOptions *options,
+    Builder *builder,
+    const std::vector<std::string>& dependencies,
+    Stats *stats)
+{
+    const char *extension = options->isCpp ? "cpp" : "c";
+    auto outputHeaderName = fmt::format("{}.h", options->output);
+
+    std::vector<std::string> targets;
+    uint64_t bytesEmitted = 0;
+
+    // sources are streamed straight from the fragments into their files,
+    // every shard is a separate unit that includes the shared header.
+    auto timer = StartTimer();
+    for (uint32_t shard = 0; shard < options->shards; ++ shard)
+    {
+        auto outputSourceName = options->shards > 1
+            ? fmt::format("{}_{}.{}", options->output, shard, extension)
+            : fmt::format("{}.{}", options->output, extension);
+
+        WriteStream(
+            outputSourceName,
+            [builder, options, shard](const SourceSink& sink) {
+                builder->WriteSource(sink, shard, options->shards);
+            },
+            &bytesEmitted
+        );
+
+        targets.push_back(outputSourceName);
+    }
+
+    // a run with fewer shards than the last one would leave its higher
+    // shards behind for globbing build rules to pick up. shards are
+    // numbered without gaps, so the first missing one ends the search.
+    if (options->shards > 1)
+    {
+        unlink(fmt::format("{}.{}", options->output, extension).c_str());
+    }
+
+    for (uint32_t shard = options->shards > 1 ? options->shards : 0; ; ++ shard)
+    {
+        if (unlink(fmt::format("{}_{}.{}", options->output, shard, extension).c_str()))
+        {
+            break;
+        }
+    }
+
+    std::vector<std::pair<std::string, std::string>> outputs;
+    outputs.emplace_back(outputHeaderName, builder->GetSourceHeader());
+
+    if (options->builderFlags & BuilderFlag_Bench)
+    {
+        auto outputBenchName = fmt::format("{}_bench.{}", options->output, extension);
+        outputs.emplace_back(outputBenchName, builder->GetBenchSource());
+    }
+
+    PhaseTime emitTime;
+    StopTimer(timer, &emitTime);
+
+    timer = StartTimer();
+    for (const auto& output : outputs)
+    {
+        Write(output.first, output.second, &bytesEmitted);
+        targets.push_back(output.first);
+    }
+
+    if (!options->depfile.empty())
+    {
+        Write(
+            options->depfile,
+            GetDepfile(targets, dependencies)
+        );
+    }
+
+    if (stats)
+    {
+        StopTimer(timer, &stats->phases[StatsPhase_Write]);
+        stats->phases[StatsPhase_Emit] = emitTime;
+        stats->bytesEmitted = bytesEmitted;
     }
 }
 
 int main(int argc, char *argv[])
 {
+    const auto start = StartTimer();
+
     struct ClcliOptions options;
     const bool success = ParseOptions(&options, argc, argv);
 
@@ -154,6 +895,12 @@ int main(int argc, char *argv[])
         chdir(options.workdir.c_str());
     }
 
+    // the profile path is relative to the workdir, like the inputs.
+    if (!options.profile.empty() && !LoadFieldProfile(options.profile, &options.fieldProfile))
+    {
+        return EXIT_FAILURE;
+    }
+
     for (const auto& input : options.inputs)
     {
         if (access(input.c_str(), R_OK))
@@ -163,19 +910,33 @@ int main(int argc, char *argv[])
         }
     }
 
-    auto outputHeaderName = fmt::format("{}.h", options.output);
-    auto outputSourceName = fmt::format("{}.{}", options.output, options.isCpp ? "cpp" : "c");
-    
-    auto builder = NewBuilder();
-    builder->Include(outputHeaderName);
-
-    for (int i = 0; i < (int) options.inputs.size(); ++ i)
+    if (options.serve)
     {
-        ProcessFile(builder, &options, i + 1);
+        return Serve(&options);
     }
 
-    Write(outputSourceName, builder->GetSource());
-    Write(outputHeaderName, builder->GetSourceHeader());
+    auto builder = NewOutputBuilder(&options);
+
+    Stats stats;
+    std::vector<InputLayout> layouts;
+    std::vector<std::string> dependencies;
+    ProcessFiles(builder, &options, &dependencies, &stats, &layouts);
+
+    WriteOutputs(&options, builder, dependencies, &stats);
     FreeBuilder(builder);
+
+    if (options.layoutReport != ReportFormat_None)
+    {
+        DeduplicateLayouts(&layouts);
+        PrintLayoutReport(layouts, options.layoutReport);
+    }
+
+    if (options.stats != ReportFormat_None)
+    {
+        SumInputStats(&stats);
+        StopProcessTimer(start, &stats.total);
+        PrintStats(stats, options.stats);
+    }
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,121 @@
+#include <set>
+#include <algorithm>
+
+#include "phash.h"
+
+uint32_t FieldHash(const std::string& name, uint32_t seed)
+{
+    uint32_t hash = seed ^ 2166136261u;
+    for (const auto c : name)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static bool TryBuildFieldIndex(
+    const std::vector<std::string>& names,
+    size_t size,
+    FieldIndex *index)
+{
+    const uint32_t mask = size - 1;
+    std::vector<std::vector<uint16_t>> buckets(size);
+
+    for (size_t i = 0; i < names.size(); ++ i)
+    {
+        buckets[FieldHash(names[i], 0) & mask].push_back(i);
+    }
+
+    std::vector<uint32_t> order(size);
+    for (uint32_t i = 0; i < size; ++ i)
+    {
+        order[i] = i;
+    }
+
+    // crowded buckets go first, while most slots are still free.
+    std::stable_sort(
+        order.begin(),
+        order.end(),
+        [&buckets](uint32_t a, uint32_t b) {
+            return buckets[a].size() > buckets[b].size();
+        }
+    );
+
+    index->seeds.assign(size, 0);
+    index->slots.assign(size, 0);
+
+    std::vector<uint32_t> taken;
+    for (const auto bucket : order)
+    {
+        const auto& columns = buckets[bucket];
+        if (columns.empty())
+        {
+            break;
+        }
+
+        uint32_t seed = 1;
+        for (; seed < (1u << 20); ++ seed)
+        {
+            taken.clear();
+            for (const auto column : columns)
+            {
+                const uint32_t slot = FieldHash(names[column], seed) & mask;
+                if (index->slots[slot]
+                    || std::find(taken.begin(), taken.end(), slot) != taken.end())
+                {
+                    break;
+                }
+
+                taken.push_back(slot);
+            }
+
+            if (taken.size() == columns.size())
+            {
+                break;
+            }
+        }
+
+        if (taken.size() != columns.size())
+        {
+            return false;
+        }
+
+        index->seeds[bucket] = seed;
+        for (size_t i = 0; i < columns.size(); ++ i)
+        {
+            index->slots[taken[i]] = columns[i] + 1;
+        }
+    }
+
+    return true;
+}
+
+bool BuildFieldIndex(const std::vector<std::string>& names, FieldIndex *index)
+{
+    // equal names can never be told apart, and slots only hold 16 bits.
+    const std::set<std::string> unique(names.begin(), names.end());
+    if (names.empty()
+        || unique.size() != names.size()
+        || names.size() >= 0xffff)
+    {
+        return false;
+    }
+
+    size_t size = 1;
+    while (size < names.size())
+    {
+        size <<= 1;
+    }
+
+    for (; size <= 0x10000; size <<= 1)
+    {
+        if (TryBuildFieldIndex(names, size, index))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
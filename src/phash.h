@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// must stay in sync with clFieldHash() emitted into the generated header.
+uint32_t FieldHash(const std::string& name, uint32_t seed);
+
+// a two-level perfect hash over the field names: the seed for a name is
+// seeds[FieldHash(name, 0) & mask], its column is slots[FieldHash(name, seed) & mask] - 1,
+// slots of value 0 are empty.
+struct FieldIndex
+{
+    std::vector<uint32_t> seeds;
+    std::vector<uint16_t> slots;
+};
+
+bool BuildFieldIndex(const std::vector<std::string>& names, FieldIndex *index);
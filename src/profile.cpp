@@ -0,0 +1,198 @@
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <fmt/format.h>
+
+#include "profile.h"
+#include "util.h"
+
+// the json form is one object of records, each an object of field
+// counts: {"Node": {"next": 120, "value": 3}}.
+struct JsonProfileParser
+{
+    const std::string& text;
+    size_t pos = 0;
+
+    explicit JsonProfileParser(const std::string& text) : text(text) {}
+
+    void SkipSpace()
+    {
+        while (pos < text.size() && isspace(static_cast<unsigned char>(text[pos])))
+        {
+            ++ pos;
+        }
+    }
+
+    bool Consume(char c)
+    {
+        SkipSpace();
+        if (pos < text.size() && text[pos] == c)
+        {
+            ++ pos;
+            return true;
+        }
+
+        return false;
+    }
+
+    // record and field names are identifiers, only the simple escapes
+    // are accepted.
+    bool ParseString(std::string *value)
+    {
+        if (!Consume('"'))
+        {
+            return false;
+        }
+
+        value->clear();
+        while (pos < text.size() && text[pos] != '"')
+        {
+            char c = text[pos ++];
+            if (c == '\\')
+            {
+                if (pos >= text.size() || !strchr("\"\\/", text[pos]))
+                {
+                    return false;
+                }
+                c = text[pos ++];
+            }
+            value->push_back(c);
+        }
+
+        return Consume('"');
+    }
+
+    bool ParseCount(uint64_t *count)
+    {
+        SkipSpace();
+
+        const size_t begin = pos;
+        *count = 0;
+        while (pos < text.size() && isdigit(static_cast<unsigned char>(text[pos])))
+        {
+            *count = *count * 10 + (text[pos ++] - '0');
+        }
+
+        return pos != begin;
+    }
+
+    template <typename Member>
+    bool ParseObject(Member member)
+    {
+        if (!Consume('{'))
+        {
+            return false;
+        }
+
+        if (Consume('}'))
+        {
+            return true;
+        }
+
+        do
+        {
+            std::string name;
+            if (!ParseString(&name) || !Consume(':') || !member(name))
+            {
+                return false;
+            }
+        }
+        while (Consume(','));
+
+        return Consume('}');
+    }
+
+    bool Parse(FieldProfile *profile)
+    {
+        const bool success = ParseObject([this, profile](const std::string& record) {
+            auto& fields = profile->records[record];
+            return ParseObject([this, &fields](const std::string& field) {
+                uint64_t count = 0;
+                if (!ParseCount(&count))
+                {
+                    return false;
+                }
+
+                fields[field] += count;
+                return true;
+            });
+        });
+
+        SkipSpace();
+        return success && pos == text.size();
+    }
+};
+
+static bool ParseTextProfile(const std::string& path, const std::string& contents, FieldProfile *profile)
+{
+    std::istringstream lines(contents);
+    std::string line;
+    uint32_t lineNumber = 0;
+
+    while (std::getline(lines, line))
+    {
+        ++ lineNumber;
+
+        std::istringstream words(line);
+        std::string record, field;
+        uint64_t count = 0;
+
+        if (!(words >> record) || record[0] == '#')
+        {
+            continue;
+        }
+
+        std::string rest;
+        if (!(words >> field >> count) || (words >> rest))
+        {
+            fmt::print(stderr, "{}:{}: expected <record> <field> <count>.\n", path, lineNumber);
+            return false;
+        }
+
+        profile->records[record][field] += count;
+    }
+
+    return true;
+}
+
+bool LoadFieldProfile(const std::string& path, FieldProfile *profile)
+{
+    std::string contents;
+    if (!ReadFile(path, &contents))
+    {
+        fmt::print(stderr, "{}: failed to read profile.\n", path);
+        return false;
+    }
+
+    // a profile starting with { is json, anything else the text form.
+    const auto first = contents.find_first_not_of(" \t\r\n");
+    if (first != std::string::npos && contents[first] == '{')
+    {
+        JsonProfileParser parser(contents);
+        if (!parser.Parse(profile))
+        {
+            fmt::print(stderr, "{}: invalid json profile at offset {}.\n", path, parser.pos);
+            return false;
+        }
+    }
+    else if (!ParseTextProfile(path, contents, profile))
+    {
+        return false;
+    }
+
+    // the counts decide the emitted tables, so the cache is keyed by them.
+    profile->hash = HashBytes(contents.data(), contents.size());
+    return true;
+}
+
+uint64_t GetFieldCount(const FieldProfile& profile, const std::string& record, const std::string& field)
+{
+    auto it = profile.records.find(record);
+    if (it == profile.records.end())
+    {
+        return 0;
+    }
+
+    auto fieldIt = it->second.find(field);
+    return fieldIt != it->second.end() ? fieldIt->second : 0;
+}
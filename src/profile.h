@@ -0,0 +1,20 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <cstdint>
+
+// field access counts by record and field name, as dumped by the
+// runtime. the text form has one "<record> <field> <count>" line per
+// field, blank lines and lines starting with # are skipped. the json
+// form maps records to objects of field counts.
+struct FieldProfile
+{
+    std::map<std::string, std::map<std::string, uint64_t>> records;
+    uint64_t hash = 0;
+};
+
+bool LoadFieldProfile(const std::string& path, FieldProfile *profile);
+
+// the count of a field, 0 when the profile does not know it.
+uint64_t GetFieldCount(const FieldProfile& profile, const std::string& record, const std::string& field);
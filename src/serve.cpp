@@ -0,0 +1,333 @@
+#include <map>
+#include <set>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <climits>
+#include <cstdlib>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <fmt/format.h>
+
+#include "clcli.h"
+#include "serve.h"
+#include "visit.h"
+#include "builder.h"
+
+struct ServedInput
+{
+    CXTranslationUnit translationUnit = nullptr;
+    Builder *builder = nullptr;
+    std::vector<std::string> dependencies;
+};
+
+struct ServeState
+{
+    struct ClcliOptions *options = nullptr;
+    CXIndex index = nullptr;
+    int notify = -1;
+    std::vector<ServedInput> inputs;
+    std::map<std::string, int> watches;
+    std::map<int, std::string> watchedDirs;
+};
+
+static std::string RealPath(const std::string& path)
+{
+    char resolved[PATH_MAX];
+    if (!realpath(path.c_str(), resolved))
+    {
+        return path;
+    }
+
+    return resolved;
+}
+
+static void Watch(ServeState *state, const std::string& path)
+{
+    // editors usually replace files by renaming over them, which drops
+    // a watch on the file itself, so the directory is watched instead.
+    const size_t slash = path.rfind('/');
+    const std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+
+    if (state->watches.count(dir))
+    {
+        return;
+    }
+
+    const int wd = inotify_add_watch(
+        state->notify,
+        dir.c_str(),
+        IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE);
+
+    if (wd < 0)
+    {
+        fmt::print(stderr, "{}: failed to watch directory.\n", dir);
+        return;
+    }
+
+    state->watches[dir] = wd;
+    state->watchedDirs[wd] = dir;
+}
+
+static bool ParseInput(ServeState *state, uint32_t inputPos)
+{
+    auto& input = state->inputs[inputPos];
+    const auto& name = state->options->inputs[inputPos];
+
+    if (input.translationUnit)
+    {
+        // the precompiled preamble is reused, only the changed part of
+        // the input goes through the parser again.
+        if (!clang_reparseTranslationUnit(
+            input.translationUnit,
+            0, nullptr,
+            clang_defaultReparseOptions(input.translationUnit)))
+        {
+            PrintDiagnostics(input.translationUnit);
+            return true;
+        }
+
+        clang_disposeTranslationUnit(input.translationUnit);
+        input.translationUnit = nullptr;
+    }
+
+    std::vector<std::string> storage;
+    std::vector<const char *> clangArgs;
+    BuildClangArgs(state->options, false, &storage, &clangArgs);
+
+    // serve mode builds no PCH, the prefix headers are included instead
+    // and end up in the precompiled preamble.
+    for (const auto& prefixHeader : state->options->prefixHeaders)
+    {
+        clangArgs.push_back("-include");
+        clangArgs.push_back(prefixHeader.c_str());
+    }
+
+    input.translationUnit = clang_parseTranslationUnit(
+        state->index,
+        name.c_str(),
+        clangArgs.data(),
+        clangArgs.size(),
+        0, 0,
+        CXTranslationUnit_SkipFunctionBodies
+            | CXTranslationUnit_PrecompiledPreamble
+            | CXTranslationUnit_CreatePreambleOnFirstParse);
+
+    if (!input.translationUnit)
+    {
+        fmt::print(stderr, "{}: failed to parse.\n", name);
+        return false;
+    }
+
+    PrintDiagnostics(input.translationUnit);
+    return true;
+}
+
+static void VisitInput(ServeState *state, uint32_t inputPos)
+{
+    auto& input = state->inputs[inputPos];
+
+    if (input.builder)
+    {
+        FreeBuilder(input.builder);
+    }
+
+    input.builder = NewBuilder(
+        state->options->backend,
+        state->options->builderFlags,
+        &state->options->fieldProfile);
+    input.dependencies.clear();
+
+    if (!input.translationUnit)
+    {
+        return;
+    }
+
+    IrUnit unit;
+    std::vector<std::string> inclusions;
+    VisitTranslationUnit(
+        &unit,
+        input.translationUnit,
+        &inclusions);
+
+    if (!state->options->roots.empty())
+    {
+        PruneIrUnit(&unit, state->options->roots);
+    }
+
+    EmitIrUnit(input.builder, unit);
+
+    for (const auto& inclusion : inclusions)
+    {
+        if (!access(inclusion.c_str(), R_OK))
+        {
+            input.dependencies.push_back(RealPath(inclusion));
+        }
+    }
+}
+
+static void UpdateInputs(ServeState *state, const std::vector<uint32_t>& inputPositions)
+{
+    RunJobs(
+        state->options->jobs,
+        inputPositions.size(),
+        [state, &inputPositions](uint32_t pos) {
+            const uint32_t inputPos = inputPositions[pos];
+            ParseInput(state, inputPos);
+            VisitInput(state, inputPos);
+        }
+    );
+
+    // a failed parse still has to be retried once its file changes.
+    for (const auto inputPos : inputPositions)
+    {
+        Watch(state, RealPath(state->options->inputs[inputPos]));
+
+        for (const auto& dependency : state->inputs[inputPos].dependencies)
+        {
+            Watch(state, dependency);
+        }
+    }
+
+    auto builder = NewOutputBuilder(state->options);
+
+    std::set<std::string> seen;
+    std::vector<std::string> dependencies;
+    for (const auto& input : state->inputs)
+    {
+        builder->Merge(input.builder);
+
+        for (const auto& dependency : input.dependencies)
+        {
+            if (seen.insert(dependency).second)
+            {
+                dependencies.push_back(dependency);
+            }
+        }
+    }
+
+    WriteOutputs(state->options, builder, dependencies);
+    FreeBuilder(builder);
+}
+
+static int ReadEvents(ServeState *state, int timeout, std::set<std::string> *changed)
+{
+    struct pollfd fd;
+    fd.fd = state->notify;
+    fd.events = POLLIN;
+
+    const int ready = poll(&fd, 1, timeout);
+    if (ready <= 0)
+    {
+        return ready;
+    }
+
+    alignas(struct inotify_event) char buffer[4096];
+    const ssize_t size = read(state->notify, buffer, sizeof(buffer));
+    if (size <= 0)
+    {
+        return -1;
+    }
+
+    for (ssize_t pos = 0; pos < size; )
+    {
+        auto event = reinterpret_cast<const struct inotify_event *>(buffer + pos);
+        pos += sizeof(struct inotify_event) + event->len;
+
+        auto it = state->watchedDirs.find(event->wd);
+        if (it != state->watchedDirs.end() && event->len)
+        {
+            changed->insert(fmt::format("{}/{}", it->second, event->name));
+        }
+    }
+
+    return 1;
+}
+
+int Serve(struct ClcliOptions *options)
+{
+    ServeState state;
+    state.options = options;
+    state.notify = inotify_init1(IN_CLOEXEC);
+
+    if (state.notify < 0)
+    {
+        fmt::print(stderr, "inotify: failed to initialize.\n");
+        return EXIT_FAILURE;
+    }
+
+    // translation units stay alive for the whole session, the explicit
+    // prefix PCH is not needed as every input keeps its own preamble.
+    state.index = clang_createIndex(0, 0);
+    state.inputs.resize(options->inputs.size());
+
+    std::vector<uint32_t> inputPositions;
+    for (uint32_t i = 0; i < options->inputs.size(); ++ i)
+    {
+        inputPositions.push_back(i);
+    }
+
+    UpdateInputs(&state, inputPositions);
+    fmt::print(stderr, "watching {} inputs.\n", options->inputs.size());
+
+    for (;;)
+    {
+        std::set<std::string> changed;
+        if (ReadEvents(&state, -1, &changed) < 0)
+        {
+            break;
+        }
+
+        // editors save in bursts, collect whatever lands right after.
+        while (ReadEvents(&state, 20, &changed) > 0)
+        {
+        }
+
+        inputPositions.clear();
+        for (uint32_t i = 0; i < state.inputs.size(); ++ i)
+        {
+            const auto& input = state.inputs[i];
+            bool affected = changed.count(RealPath(options->inputs[i])) > 0;
+
+            for (const auto& dependency : input.dependencies)
+            {
+                affected = affected || changed.count(dependency) > 0;
+            }
+
+            if (affected)
+            {
+                inputPositions.push_back(i);
+            }
+        }
+
+        if (inputPositions.empty())
+        {
+            continue;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        UpdateInputs(&state, inputPositions);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        fmt::print(
+            stderr,
+            "updated {} inputs in {} ms.\n",
+            inputPositions.size(),
+            std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+    }
+
+    for (auto& input : state.inputs)
+    {
+        if (input.translationUnit)
+        {
+            clang_disposeTranslationUnit(input.translationUnit);
+        }
+
+        FreeBuilder(input.builder);
+    }
+
+    clang_disposeIndex(state.index);
+    close(state.notify);
+    return EXIT_FAILURE;
+}
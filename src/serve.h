@@ -0,0 +1,5 @@
+#pragma once
+
+struct ClcliOptions;
+
+int Serve(struct ClcliOptions *options);
@@ -0,0 +1,239 @@
+#include <ctime>
+#include <cstdio>
+#include <algorithm>
+#include <fmt/format.h>
+
+#include "stats.h"
+#include "util.h"
+
+static const char *kPhaseNames[StatsPhase_Count] = {
+    "parse",
+    "diagnostics",
+    "visit",
+    "cache",
+    "merge",
+    "emit",
+    "write",
+};
+
+static double ReadClock(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+StatsTimer StartTimer()
+{
+    StatsTimer timer;
+    timer.wall = ReadClock(CLOCK_MONOTONIC);
+    timer.cpu = ReadClock(CLOCK_THREAD_CPUTIME_ID);
+    timer.processCpu = ReadClock(CLOCK_PROCESS_CPUTIME_ID);
+    return timer;
+}
+
+void StopTimer(const StatsTimer& timer, PhaseTime *phase)
+{
+    phase->wall += ReadClock(CLOCK_MONOTONIC) - timer.wall;
+    phase->cpu += ReadClock(CLOCK_THREAD_CPUTIME_ID) - timer.cpu;
+}
+
+void StopProcessTimer(const StatsTimer& timer, PhaseTime *phase)
+{
+    phase->wall += ReadClock(CLOCK_MONOTONIC) - timer.wall;
+    phase->cpu += ReadClock(CLOCK_PROCESS_CPUTIME_ID) - timer.processCpu;
+}
+
+void SumInputStats(Stats *stats)
+{
+    for (const auto& input : stats->inputs)
+    {
+        for (uint32_t i = 0; i < StatsPhase_Count; ++ i)
+        {
+            stats->phases[i].wall += input.phases[i].wall;
+            stats->phases[i].cpu += input.phases[i].cpu;
+        }
+
+        stats->visit.records += input.visit.records;
+        stats->visit.fields += input.visit.fields;
+        stats->visit.clangCalls += input.visit.clangCalls;
+        stats->visit.pruned += input.visit.pruned;
+    }
+}
+
+static double InputWall(const InputStats& input)
+{
+    double wall = 0;
+    for (const auto& phase : input.phases)
+    {
+        wall += phase.wall;
+    }
+
+    return wall;
+}
+
+static void FormatJsonPhases(
+    fmt::memory_buffer *buffer,
+    const PhaseTime *phases,
+    uint32_t first,
+    uint32_t last)
+{
+    for (uint32_t i = first; i < last; ++ i)
+    {
+        fmt::format_to(
+            std::back_inserter(*buffer),
+            "{}\"{}\": {{\"wall_ms\": {:.3f}, \"cpu_ms\": {:.3f}}}",
+            i == first ? "" : ", ",
+            kPhaseNames[i],
+            phases[i].wall * 1e3,
+            phases[i].cpu * 1e3
+        );
+    }
+}
+
+static void PrintJsonStats(const Stats& stats)
+{
+    fmt::memory_buffer buffer;
+    fmt::format_to(
+        std::back_inserter(buffer),
+        "{{\n"
+        "  \"total\": {{\"wall_ms\": {:.3f}, \"cpu_ms\": {:.3f}}},\n"
+        "  \"records\": {},\n"
+        "  \"pruned\": {},\n"
+        "  \"fields\": {},\n"
+        "  \"clang_calls\": {},\n"
+        "  \"bytes_emitted\": {},\n"
+        "  \"phases\": {{",
+        stats.total.wall * 1e3,
+        stats.total.cpu * 1e3,
+        stats.visit.records,
+        stats.visit.pruned,
+        stats.visit.fields,
+        stats.visit.clangCalls,
+        stats.bytesEmitted
+    );
+
+    FormatJsonPhases(&buffer, stats.phases, 0, StatsPhase_Count);
+
+    fmt::format_to(
+        std::back_inserter(buffer),
+        "}},\n"
+        "  \"inputs\": ["
+    );
+
+    for (size_t i = 0; i < stats.inputs.size(); ++ i)
+    {
+        const auto& input = stats.inputs[i];
+
+        fmt::format_to(
+            std::back_inserter(buffer),
+            "{}\n    {{\"input\": {}, \"cached\": {}, \"records\": {}, \"pruned\": {}, \"fields\": {}, \"clang_calls\": {}, \"phases\": {{",
+            i ? "," : "",
+            JsonString(input.input),
+            input.cached ? "true" : "false",
+            input.visit.records,
+            input.visit.pruned,
+            input.visit.fields,
+            input.visit.clangCalls
+        );
+
+        FormatJsonPhases(&buffer, input.phases, 0, StatsPhase_Merge);
+
+        fmt::format_to(
+            std::back_inserter(buffer),
+            "}}}}"
+        );
+    }
+
+    fmt::format_to(
+        std::back_inserter(buffer),
+        "\n  ]\n"
+        "}}\n"
+    );
+
+    fwrite(buffer.data(), buffer.size(), 1, stdout);
+}
+
+static void PrintTextStats(const Stats& stats)
+{
+    fmt::print(stderr, "{:<16} {:>12} {:>12}\n", "phase", "wall ms", "cpu ms");
+    for (uint32_t i = 0; i < StatsPhase_Count; ++ i)
+    {
+        fmt::print(
+            stderr,
+            "{:<16} {:>12.3f} {:>12.3f}\n",
+            kPhaseNames[i],
+            stats.phases[i].wall * 1e3,
+            stats.phases[i].cpu * 1e3);
+    }
+
+    fmt::print(
+        stderr,
+        "{:<16} {:>12.3f} {:>12.3f}\n\n",
+        "total",
+        stats.total.wall * 1e3,
+        stats.total.cpu * 1e3);
+
+    fmt::print(
+        stderr,
+        "records {}, pruned {}, fields {}, libclang calls {}, bytes emitted {}\n\n",
+        stats.visit.records,
+        stats.visit.pruned,
+        stats.visit.fields,
+        stats.visit.clangCalls,
+        stats.bytesEmitted);
+
+    // slowest inputs first, they are the ones worth looking at.
+    std::vector<const InputStats *> inputs;
+    for (const auto& input : stats.inputs)
+    {
+        inputs.push_back(&input);
+    }
+
+    std::stable_sort(
+        inputs.begin(),
+        inputs.end(),
+        [](const InputStats *a, const InputStats *b) {
+            return InputWall(*a) > InputWall(*b);
+        }
+    );
+
+    fmt::print(
+        stderr,
+        "{:<32} {:>12} {:>12} {:>12} {:>12} {:>8}\n",
+        "input",
+        "parse ms",
+        "diag ms",
+        "visit ms",
+        "cache ms",
+        "fields");
+
+    for (const auto input : inputs)
+    {
+        fmt::print(
+            stderr,
+            "{:<32} {:>12.3f} {:>12.3f} {:>12.3f} {:>12.3f} {:>8}{}\n",
+            input->input,
+            input->phases[StatsPhase_Parse].wall * 1e3,
+            input->phases[StatsPhase_Diagnostics].wall * 1e3,
+            input->phases[StatsPhase_Visit].wall * 1e3,
+            input->phases[StatsPhase_Cache].wall * 1e3,
+            input->visit.fields,
+            input->cached ? " (cached)" : "");
+    }
+}
+
+void PrintStats(const Stats& stats, ReportFormat format)
+{
+    switch (format)
+    {
+        case ReportFormat_Text:
+            PrintTextStats(stats);
+            return;
+        case ReportFormat_Json:
+            PrintJsonStats(stats);
+            return;
+        default:
+            return;
+    }
+}
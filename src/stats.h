@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+enum ReportFormat
+{
+    ReportFormat_None,
+    ReportFormat_Text,
+    ReportFormat_Json,
+};
+
+enum StatsPhase
+{
+    StatsPhase_Parse,
+    StatsPhase_Diagnostics,
+    StatsPhase_Visit,
+    StatsPhase_Cache,
+    StatsPhase_Merge,
+    StatsPhase_Emit,
+    StatsPhase_Write,
+    StatsPhase_Count,
+};
+
+struct PhaseTime
+{
+    double wall = 0;
+    double cpu = 0;
+};
+
+// counters of one traversal, clangCalls counts parse calls plus every
+// cursor and inclusion libclang hands back to the visitor. pruned counts
+// the visited records no --root reaches.
+struct VisitStats
+{
+    uint64_t records = 0;
+    uint64_t fields = 0;
+    uint64_t clangCalls = 0;
+    uint64_t pruned = 0;
+};
+
+struct InputStats
+{
+    std::string input;
+    bool cached = false;
+    PhaseTime phases[StatsPhase_Count];
+    VisitStats visit;
+};
+
+struct Stats
+{
+    PhaseTime phases[StatsPhase_Count];
+    PhaseTime total;
+    VisitStats visit;
+    uint64_t bytesEmitted = 0;
+    std::vector<InputStats> inputs;
+};
+
+// cpu time is measured on the calling thread, so a phase split across
+// workers is timed inside each worker and summed afterwards.
+struct StatsTimer
+{
+    double wall;
+    double cpu;
+    double processCpu;
+};
+
+StatsTimer StartTimer();
+void StopTimer(const StatsTimer& timer, PhaseTime *phase);
+void StopProcessTimer(const StatsTimer& timer, PhaseTime *phase);
+
+void SumInputStats(Stats *stats);
+void PrintStats(const Stats& stats, ReportFormat format);
@@ -1,3 +1,5 @@
+#include <cstdio>
+#include <cstring>
 #include <fmt/format.h>
 
 #include "util.h"
@@ -33,3 +35,104 @@ std::string GetCursorDisplayName(CXCursor cursor)
 
     return spellingStr;
 }
+
+
+std::string GetCursorUSR(CXCursor cursor)
+{
+    CXString usr = clang_getCursorUSR(cursor);
+    std::string usrStr = clang_getCString(usr);
+    clang_disposeString(usr);
+
+    return usrStr;
+}
+
+uint64_t HashBytes(const void *data, size_t size, uint64_t hash)
+{
+    // FNV-1a, stable across runs and platforms.
+    auto bytes = reinterpret_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++ i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+bool ReadFile(const std::string& path, std::string *contents)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        return false;
+    }
+
+    contents->clear();
+
+    char buffer[8192];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    {
+        contents->append(buffer, n);
+    }
+
+    const bool success = !ferror(f);
+    fclose(f);
+    return success;
+}
+
+bool SameFileContents(const std::string& a, const std::string& b)
+{
+    FILE *fa = fopen(a.c_str(), "rb");
+    FILE *fb = fopen(b.c_str(), "rb");
+
+    bool same = fa && fb;
+    while (same)
+    {
+        char bufferA[8192], bufferB[8192];
+        const size_t na = fread(bufferA, 1, sizeof(bufferA), fa);
+        const size_t nb = fread(bufferB, 1, sizeof(bufferB), fb);
+
+        same = na == nb && !memcmp(bufferA, bufferB, na) && !ferror(fa) && !ferror(fb);
+        if (!na || !same)
+        {
+            break;
+        }
+    }
+
+    if (fa)
+    {
+        fclose(fa);
+    }
+
+    if (fb)
+    {
+        fclose(fb);
+    }
+
+    return same;
+}
+
+std::string JsonString(const std::string& value)
+{
+    std::string escaped = "\"";
+    for (const auto c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped.push_back('\\');
+            escaped.push_back(c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            escaped += fmt::format("\\u{:04x}", c);
+        }
+        else
+        {
+            escaped.push_back(c);
+        }
+    }
+
+    escaped.push_back('"');
+    return escaped;
+}
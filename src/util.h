@@ -2,9 +2,16 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 #include <clang-c/Index.h>
 
 std::string GetString(CXString string);
 std::string GetTypeSpelling(CXType type);
 std::string GetCursorSpelling(CXCursor cursor);
 std::string GetCursorDisplayName(CXCursor cursor);
+std::string GetCursorUSR(CXCursor cursor);
+
+uint64_t HashBytes(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ull);
+bool ReadFile(const std::string& path, std::string *contents);
+bool SameFileContents(const std::string& a, const std::string& b);
+std::string JsonString(const std::string& value);
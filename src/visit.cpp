@@ -1,12 +1,57 @@
 #include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <algorithm>
+#include <unordered_map>
 #include <fmt/format.h>
 
 #include "visit.h"
 #include "util.h"
-#include "builder.h"
+#include "stats.h"
+#include "ir.h"
 
-void VisitUnionOrStruct(Builder *builder, CXCursor cursor);
-void VisitUnionOrStructField(Builder *builder, CXCursor cursor);
+// the record being built, fields are appended to it as they are visited.
+struct VisitContext
+{
+    IrUnit *unit = nullptr;
+    IrRecord *record = nullptr;
+    CXCursor recordCursor;
+    VisitStats *stats = nullptr;
+};
+
+void VisitUnionOrStruct(VisitContext *context, CXCursor cursor);
+void VisitUnionOrStructField(VisitContext *context, CXCursor cursor);
+
+static void CountVisit(VisitContext *context, uint64_t VisitStats::*counter)
+{
+    if (context->stats)
+    {
+        ++ (context->stats->*counter);
+    }
+}
+
+static const char *InternString(IrArena *arena, CXString string)
+{
+    const char *interned = arena->Intern(clang_getCString(string));
+    clang_disposeString(string);
+    return interned;
+}
+
+static IrLocation GetLocation(IrArena *arena, CXCursor cursor)
+{
+    CXSourceLocation location = clang_getCursorLocation(cursor);
+
+    CXString name;
+    unsigned int line = 0, column = 0;
+    clang_getPresumedLocation(location, &name, &line, &column);
+
+    IrLocation irLocation;
+    irLocation.file = InternString(arena, name);
+    irLocation.line = line;
+    irLocation.column = column;
+    return irLocation;
+}
 
 void LineError(CXCursor cursor)
 {
@@ -28,35 +73,34 @@ void LineError(CXCursor cursor)
     clang_disposeString(name);
 }
 
-void HandleFieldArray(Builder *builder, CXCursor cursor)
+static void AnnotationError(CXCursor cursor, const std::string& annotation)
 {
-    CXType type = clang_getCursorType(cursor);
-    CXType elementType = clang_getArrayElementType(type);
+    CXSourceLocation location = clang_getCursorLocation(cursor);
 
-    builder->DefineArrayField(
-        cursor,
-        clang_getTypeDeclaration(
-            clang_getCanonicalType(elementType))
-    );
+    CXString name;
+    unsigned int line = 0, column = 0;
+    clang_getPresumedLocation(location, &name, &line, &column);
+
+    fmt::print(
+        stderr,
+        "{}:{}:{} message: invalid annotation {}\n",
+        clang_getCString(name),
+        line,
+        column,
+        annotation);
+
+    clang_disposeString(name);
 }
 
-void HandleField(Builder *builder, CXCursor cursor)
+NumberType GetNumberType(CXType canonicalType)
 {
-    CXType type = clang_getCursorType(cursor);
-    CXType canonicalType = clang_getCanonicalType(type);
-
-    CXCursor declaration = clang_getTypeDeclaration(canonicalType);
-    if (declaration.kind == CXCursor_StructDecl ||
-        declaration.kind == CXCursor_UnionDecl ||
-        declaration.kind == CXCursor_ClassDecl)
-    {
-        builder->DefineObjectField(cursor);
-        return ;
-    }
+    NumberType numberType;
 
     switch (canonicalType.kind)
     {
         case CXType_Bool:
+            numberType.kind = NumberKind_Bool;
+            break;
         case CXType_Char_U:
         case CXType_UChar:
         case CXType_Char16:
@@ -66,6 +110,8 @@ void HandleField(Builder *builder, CXCursor cursor)
         case CXType_ULong:
         case CXType_ULongLong:
         case CXType_UInt128:
+            numberType.kind = NumberKind_Unsigned;
+            break;
         case CXType_Char_S:
         case CXType_SChar:
         case CXType_Short:
@@ -73,46 +119,491 @@ void HandleField(Builder *builder, CXCursor cursor)
         case CXType_Long:
         case CXType_LongLong:
         case CXType_Int128:
+            numberType.kind = NumberKind_Signed;
+            break;
         case CXType_Float:
         case CXType_Double:
-        case CXType_LongDouble:
         case CXType_Float128:
         case CXType_Half:
         case CXType_Float16:
+            numberType.kind = NumberKind_Float;
+            break;
+        case CXType_LongDouble:
+            numberType.kind = NumberKind_LongDouble;
+            break;
         case CXType_Enum:
-            builder->DefineNumberField(cursor);
+            numberType = GetNumberType(
+                clang_getCanonicalType(
+                    clang_getEnumDeclIntegerType(
+                        clang_getTypeDeclaration(canonicalType))));
+            numberType.isEnum = true;
+            return numberType;
+        default:
+            return numberType;
+    }
+
+    numberType.size = clang_Type_getSizeOf(canonicalType);
+    return numberType;
+}
+
+// only named records defined outside the system headers get tables,
+// opaque records and e.g. FILE have nothing to refer to.
+static bool IsEmittedRecord(CXCursor declaration)
+{
+    CXCursor definition = clang_getCursorDefinition(declaration);
+    return !clang_Cursor_isNull(definition)
+        && !clang_Location_isInSystemHeader(clang_getCursorLocation(definition))
+        && !GetCursorDisplayName(definition).empty();
+}
+
+bool HandleFieldArray(VisitContext *context, CXCursor cursor, IrField *field)
+{
+    CXType type = clang_getCursorType(cursor);
+    CXType elementType = clang_getCanonicalType(
+        clang_getArrayElementType(type));
+
+    // multi-dimensional arrays are flat in memory, the innermost
+    // element decides the kind.
+    CXType scalarType = elementType;
+    while (scalarType.kind == CXType_ConstantArray)
+    {
+        scalarType = clang_getCanonicalType(
+            clang_getArrayElementType(scalarType));
+    }
+
+    // elements are emitted records or numbers, arrays of pointers and
+    // the like have no wire form.
+    CXCursor elementDeclaration = clang_getTypeDeclaration(elementType);
+    if (elementDeclaration.kind == CXCursor_StructDecl
+        || elementDeclaration.kind == CXCursor_UnionDecl
+        || elementDeclaration.kind == CXCursor_ClassDecl)
+    {
+        if (!IsEmittedRecord(elementDeclaration))
+        {
+            return false;
+        }
+
+        field->elementName = InternString(
+            &context->unit->arena,
+            clang_getCursorDisplayName(elementDeclaration));
+        field->elementIsUnion = elementDeclaration.kind == CXCursor_UnionDecl;
+    }
+    else if ((field->number = GetNumberType(scalarType)).kind == NumberKind_None)
+    {
+        return false;
+    }
+
+    field->kind = IrFieldKind_Array;
+    return true;
+}
+
+bool HandleFieldPointer(VisitContext *context, CXType type, IrField *field)
+{
+    CXType pointeeType = clang_getCanonicalType(
+        clang_getPointeeType(type));
+
+    // records are pointed to as a whole, scalars as a borrowed view of
+    // the input, anything else has no wire form.
+    CXCursor declaration = clang_getTypeDeclaration(pointeeType);
+    if (declaration.kind == CXCursor_StructDecl
+        || declaration.kind == CXCursor_ClassDecl)
+    {
+        if (!IsEmittedRecord(declaration))
+        {
+            return false;
+        }
+
+        field->elementName = InternString(
+            &context->unit->arena,
+            clang_getCursorDisplayName(declaration));
+    }
+    else if ((field->number = GetNumberType(pointeeType)).kind == NumberKind_None)
+    {
+        return false;
+    }
+
+    field->kind = IrFieldKind_Pointer;
+    field->pointeeIsChar = pointeeType.kind == CXType_Char_S
+        || pointeeType.kind == CXType_Char_U;
+    return true;
+}
+
+// the outermost namespace of a declaration, inline namespaces such as
+// std::__1 or std::__cxx11 are looked through.
+static bool IsInNamespaceStd(CXCursor cursor)
+{
+    std::string outermost;
+    for (CXCursor parent = clang_getCursorSemanticParent(cursor);
+        !clang_Cursor_isNull(parent) && parent.kind != CXCursor_TranslationUnit;
+        parent = clang_getCursorSemanticParent(parent))
+    {
+        if (parent.kind == CXCursor_Namespace)
+        {
+            outermost = GetCursorSpelling(parent);
+        }
+    }
+
+    return outermost == "std";
+}
+
+// None for any type outside namespace std. every other std template
+// is Unsupported unless it is one of the containers with a wire form,
+// std types are never visited records.
+enum ContainerMatch
+{
+    ContainerMatch_None,
+    ContainerMatch_Supported,
+    ContainerMatch_Unsupported,
+};
+
+ContainerMatch HandleFieldContainer(VisitContext *context, CXType type, IrField *field)
+{
+    CXCursor declaration = clang_getTypeDeclaration(type);
+    CXCursor specialized = clang_getSpecializedCursorTemplate(declaration);
+    if (clang_Cursor_isNull(specialized) || !IsInNamespaceStd(specialized))
+    {
+        return ContainerMatch_None;
+    }
+
+    if (clang_Type_getNumTemplateArguments(type) < 1)
+    {
+        return ContainerMatch_Unsupported;
+    }
+
+    const std::string name = GetCursorSpelling(specialized);
+    CXType elementType = clang_getCanonicalType(
+        clang_Type_getTemplateArgumentAsType(type, 0));
+
+    if (name == "basic_string")
+    {
+        // wide strings have no wire form yet.
+        if (elementType.kind != CXType_Char_S
+            && elementType.kind != CXType_Char_U)
+        {
+            return ContainerMatch_Unsupported;
+        }
+
+        field->container = IrContainer_String;
+        field->number = GetNumberType(elementType);
+    }
+    else if (name == "vector" || name == "array")
+    {
+        // std::vector<bool> packs its bits and has no element storage.
+        field->container = name == "vector" ? IrContainer_Vector : IrContainer_Array;
+        if (field->container == IrContainer_Vector && elementType.kind == CXType_Bool)
+        {
+            return ContainerMatch_Unsupported;
+        }
+
+        // nested containers and other templates are not visited records.
+        CXCursor elementDeclaration = clang_getTypeDeclaration(elementType);
+        if (elementDeclaration.kind == CXCursor_StructDecl
+            || elementDeclaration.kind == CXCursor_ClassDecl)
+        {
+            if (!clang_Cursor_isNull(clang_getSpecializedCursorTemplate(elementDeclaration))
+                || !IsEmittedRecord(elementDeclaration))
+            {
+                return ContainerMatch_Unsupported;
+            }
+
+            field->elementName = InternString(
+                &context->unit->arena,
+                clang_getCursorDisplayName(elementDeclaration));
+        }
+        else if ((field->number = GetNumberType(elementType)).kind == NumberKind_None)
+        {
+            return ContainerMatch_Unsupported;
+        }
+    }
+    else
+    {
+        return ContainerMatch_Unsupported;
+    }
+
+    field->kind = IrFieldKind_Container;
+    return ContainerMatch_Supported;
+}
+
+static const IrField *FindLengthField(const IrRecord *record, const char *name)
+{
+    for (auto field = record->fields; field; field = field->next)
+    {
+        if (!strcmp(field->name, name))
+        {
+            const auto kind = field->number.kind;
+            return field->kind == IrFieldKind_Number
+                && !field->isBitField
+                && (kind == NumberKind_Signed || kind == NumberKind_Unsigned)
+                ? field : nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+static bool ApplyAnnotation(VisitContext *context, const std::string& hint, IrField *field)
+{
+    static const struct
+    {
+        const char *name;
+        IrEncoding encoding;
+    } encodings[] = {
+        {"varint", IrEncoding_Varint},
+        {"zigzag", IrEncoding_Zigzag},
+        {"fixed", IrEncoding_Fixed},
+        {"delta", IrEncoding_Delta},
+    };
+
+    const auto kind = field->number.kind;
+    const bool isCounted = field->kind == IrFieldKind_Array
+        || field->kind == IrFieldKind_Pointer;
+    const bool isBounded = isCounted
+        || field->kind == IrFieldKind_Container;
+
+    for (const auto& encoding : encodings)
+    {
+        if (hint != encoding.name)
+        {
+            continue;
+        }
+
+        // only integers have a choice of encoding, and zigzag only pays
+        // off for signed ones.
+        if (field->elementName
+            || field->isBitField
+            || (field->kind == IrFieldKind_Pointer && field->pointeeIsChar)
+            || (field->kind == IrFieldKind_Container && field->container == IrContainer_String)
+            || (kind != NumberKind_Signed && kind != NumberKind_Unsigned)
+            || (encoding.encoding == IrEncoding_Zigzag && kind != NumberKind_Signed))
+        {
+            return false;
+        }
+
+        field->encoding = encoding.encoding;
+        return true;
+    }
+
+    // the length has to be decoded before the elements it counts, so it
+    // must be declared before them.
+    if (!hint.compare(0, 7, "length="))
+    {
+        auto arena = &context->unit->arena;
+        auto name = arena->Intern(hint.c_str() + 7);
+
+        if (!isCounted || !FindLengthField(context->record, name))
+        {
+            return false;
+        }
+
+        field->lengthField = name;
+        return true;
+    }
+
+    if (!hint.compare(0, 4, "max="))
+    {
+        char *end = nullptr;
+        const auto maxCount = strtoul(hint.c_str() + 4, &end, 10);
+
+        if (!isBounded || *end || !maxCount || maxCount > UINT32_MAX)
+        {
+            return false;
+        }
+
+        field->maxCount = maxCount;
+        return true;
+    }
+
+    return false;
+}
+
+// reads the clcli: annotations of a field, annotations of other tools
+// are left alone. an invalid hint is reported and dropped.
+void HandleFieldAnnotations(VisitContext *context, CXCursor cursor, IrField *field)
+{
+    static const std::string prefix = "clcli:";
+
+    visitChildren(
+        context,
+        cursor,
+        [cursor, field](VisitContext *context, CXCursor child) {
+            CountVisit(context, &VisitStats::clangCalls);
+
+            if (child.kind != CXCursor_AnnotateAttr)
+            {
+                return;
+            }
+
+            CXString spelling = clang_getCursorSpelling(child);
+            const std::string annotation = clang_getCString(spelling);
+            clang_disposeString(spelling);
+
+            if (annotation.compare(0, prefix.size(), prefix))
+            {
+                return;
+            }
+
+            if (!ApplyAnnotation(context, annotation.substr(prefix.size()), field))
+            {
+                AnnotationError(cursor, annotation);
+            }
+        }
+    );
+}
+
+void HandleField(VisitContext *context, CXCursor cursor)
+{
+    CountVisit(context, &VisitStats::fields);
+
+    CXType type = clang_getCursorType(cursor);
+    CXType canonicalType = clang_getCanonicalType(type);
+
+    auto arena = &context->unit->arena;
+    auto field = arena->New<IrField>();
+
+    CXCursor declaration = clang_getTypeDeclaration(canonicalType);
+    if (declaration.kind == CXCursor_StructDecl ||
+        declaration.kind == CXCursor_UnionDecl ||
+        declaration.kind == CXCursor_ClassDecl)
+    {
+        // std containers are records too, but are never visited.
+        const auto container = HandleFieldContainer(context, canonicalType, field);
+        if (container == ContainerMatch_Unsupported)
+        {
+            LineError(cursor);
             return ;
-        case CXType_ConstantArray:
-        case CXType_VariableArray:
-            HandleFieldArray(builder, cursor);
+        }
+
+        if (container == ContainerMatch_None)
+        {
+            field->kind = IrFieldKind_Object;
+            field->elementName = InternString(
+                arena,
+                clang_getCursorDisplayName(declaration));
+            field->elementIsUnion = declaration.kind == CXCursor_UnionDecl;
+        }
+    }
+    else if ((field->number = GetNumberType(canonicalType)).kind != NumberKind_None)
+    {
+        field->kind = IrFieldKind_Number;
+    }
+    else if (canonicalType.kind == CXType_ConstantArray
+        || canonicalType.kind == CXType_VariableArray)
+    {
+        if (!HandleFieldArray(context, cursor, field))
+        {
+            LineError(cursor);
             return ;
-        default:
+        }
+    }
+    else if (canonicalType.kind != CXType_Pointer
+        || !HandleFieldPointer(context, canonicalType, field))
+    {
+        LineError(cursor);
+        return ;
+    }
+
+    field->name = InternString(arena, clang_getCursorDisplayName(cursor));
+    field->offset = clang_Cursor_getOffsetOfField(cursor);
+    field->isBitField = clang_Cursor_isBitField(cursor);
+    field->size = std::max(clang_Type_getSizeOf(canonicalType), 0ll);
+    field->align = std::max(clang_Type_getAlignOf(canonicalType), 0ll);
+    field->bitWidth = field->isBitField ? clang_getFieldDeclBitWidth(cursor) : field->size * 8;
+    field->isDirect = clang_equalCursors(
+        clang_getCursorSemanticParent(cursor),
+        context->recordCursor);
+
+    if (field->isBitField)
+    {
+        // unnamed bitfields only pad, and a base class bitfield has no
+        // storage unit offset relative to the record.
+        if (!*field->name)
+        {
+            return ;
+        }
+
+        if (!field->isDirect)
+        {
             LineError(cursor);
             return ;
+        }
     }
+
+    HandleFieldAnnotations(context, cursor, field);
+    AddIrField(context->record, field);
 }
 
-void HandleBaseClass(Builder *builder, CXCursor cursor)
+static bool IsFlatRecord(const IrRecord *record)
+{
+    if (record->isUnion || record->hasBases || !record->fields)
+    {
+        return false;
+    }
+
+    for (auto field = record->fields; field; field = field->next)
+    {
+        const auto size = field->number.size;
+        if (field->kind != IrFieldKind_Number
+            || field->isBitField
+            || !field->isDirect
+            || field->offset < 0
+            || (size != 1 && size != 2 && size != 4 && size != 8))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// element records precede the arrays holding them, but are only known
+// by name while the array field is visited.
+static void LinkFlatElements(IrUnit *unit)
+{
+    std::unordered_map<const char *, const IrRecord *> flatRecords;
+    for (auto record = unit->records; record; record = record->next)
+    {
+        if (record->isFlat)
+        {
+            flatRecords.emplace(record->name, record);
+        }
+    }
+
+    for (auto record = unit->records; record; record = record->next)
+    {
+        for (auto field = record->fields; field; field = field->next)
+        {
+            if (field->kind == IrFieldKind_Array && field->elementName)
+            {
+                field->elementIsFlat = flatRecords.count(field->elementName) != 0;
+            }
+        }
+    }
+}
+
+void HandleBaseClass(VisitContext *context, CXCursor cursor)
 {
     visitChildren(
-        builder,
+        context,
         cursor,
         VisitUnionOrStructField
     );
 }
 
-void VisitUnionOrStructField(Builder *builder, CXCursor cursor)
+void VisitUnionOrStructField(VisitContext *context, CXCursor cursor)
 {
+    CountVisit(context, &VisitStats::clangCalls);
+
     switch (cursor.kind)
     {
         case CXCursor_CXXBaseSpecifier:
+            context->record->hasBases = true;
             HandleBaseClass(
-                builder,
+                context,
                 clang_getCursorDefinition(cursor));
             return ;
         case CXCursor_FieldDecl:
             HandleField(
-                builder,
+                context,
                 cursor);
             return ;
         case CXCursor_StructDecl:
@@ -124,31 +615,81 @@ void VisitUnionOrStructField(Builder *builder, CXCursor cursor)
     }
 }
 
-void VisitUnionOrStruct(Builder *builder, CXCursor cursor)
+void HandleMember(VisitContext *context, CXCursor cursor)
 {
-    const auto name = GetCursorDisplayName(cursor);
-    if (name.empty())
+    CountVisit(context, &VisitStats::clangCalls);
+
+    auto arena = &context->unit->arena;
+    CXType type = clang_getCanonicalType(clang_getCursorType(cursor));
+
+    auto member = arena->New<IrMember>();
+    member->name = InternString(arena, clang_getCursorDisplayName(cursor));
+    member->offset = clang_Cursor_getOffsetOfField(cursor);
+    member->isBitField = clang_Cursor_isBitField(cursor);
+    member->size = std::max(clang_Type_getSizeOf(type), 0ll);
+    member->align = std::max(clang_Type_getAlignOf(type), 0ll);
+    member->bitWidth = member->isBitField ? clang_getFieldDeclBitWidth(cursor) : member->size * 8;
+
+    AddIrMember(context->record, member);
+}
+
+void VisitUnionOrStruct(VisitContext *context, CXCursor cursor)
+{
+    auto arena = &context->unit->arena;
+
+    const char *name = InternString(arena, clang_getCursorDisplayName(cursor));
+    if (!*name)
     {
         return;
     }
 
-    builder->EnterObject(cursor);
+    CountVisit(context, &VisitStats::records);
+
+    CXType type = clang_getCursorType(cursor);
+
+    auto record = arena->New<IrRecord>();
+    record->usr = InternString(arena, clang_getCursorUSR(cursor));
+    record->name = name;
+    record->type = InternString(arena, clang_getTypeSpelling(type));
+    record->isUnion = cursor.kind == CXCursor_UnionDecl;
+    record->location = GetLocation(arena, cursor);
+
+    record->size = std::max(clang_Type_getSizeOf(type), 0ll);
+    record->align = std::max(clang_Type_getAlignOf(type), 0ll);
+
+    context->record = record;
+    context->recordCursor = cursor;
 
     visitChildren(
-        builder,
+        context,
         cursor,
         VisitUnionOrStructField
     );
 
-    builder->LeaveObject();
+    // the fields above skip what has no wire form, the layout needs every
+    // member, including the implicit ones of anonymous records.
+    if (context->unit->withMembers)
+    {
+        visitField(
+            context,
+            type,
+            HandleMember
+        );
+    }
+
+    record->isFlat = IsFlatRecord(record);
+    AddIrRecord(context->unit, record);
+    context->record = nullptr;
 }
 
-void SearchNamespaceOrUnionOrStruct(Builder *builder, CXCursor cursor)
+void SearchNamespaceOrUnionOrStruct(VisitContext *context, CXCursor cursor)
 {
     visitChildren(
-        builder,
+        context,
         cursor,
-        [](Builder *builder, CXCursor cursor) {
+        [](VisitContext *context, CXCursor cursor) {
+            CountVisit(context, &VisitStats::clangCalls);
+
             if (cursor.kind != CXCursor_StructDecl 
                 && cursor.kind != CXCursor_Namespace
                 && cursor.kind != CXCursor_ClassDecl
@@ -166,7 +707,7 @@ void SearchNamespaceOrUnionOrStruct(Builder *builder, CXCursor cursor)
 
             if (cursor.kind == CXCursor_Namespace)
             {
-                SearchNamespaceOrUnionOrStruct(builder, cursor);
+                SearchNamespaceOrUnionOrStruct(context, cursor);
                 return;
             }
 
@@ -176,30 +717,53 @@ void SearchNamespaceOrUnionOrStruct(Builder *builder, CXCursor cursor)
                 return;
             }
 
-            VisitUnionOrStruct(builder, cursor);
+            VisitUnionOrStruct(context, cursor);
         }
     );
 }
 
-void VisitTranslationUnit(Builder *builder, CXTranslationUnit unit)
+void VisitTranslationUnit(
+    IrUnit *irUnit,
+    CXTranslationUnit unit,
+    std::vector<std::string> *dependencies,
+    VisitStats *stats)
 {
+    VisitContext context;
+    context.unit = irUnit;
+    context.stats = stats;
+
+    CXString unitName = clang_getTranslationUnitSpelling(unit);
+    CXFile mainFile = clang_getFile(unit, clang_getCString(unitName));
+    clang_disposeString(unitName);
+
     visitInclusion(
-        builder,
+        &context,
         unit,
-        [unit](Builder *builder, uint32_t depth, CXFile includedFile) {
-            if (!depth)
+        [mainFile, dependencies](VisitContext *context, uint32_t depth, CXFile includedFile) {
+            CountVisit(context, &VisitStats::clangCalls);
+
+            auto name = InternString(
+                &context->unit->arena,
+                clang_getFileName(includedFile));
+
+            if (dependencies)
             {
-                auto name = clang_getFileName(includedFile);
-                auto nameStr = GetString(name);
-                clang_disposeString(name);
+                dependencies->push_back(name);
+            }
 
-                builder->Include(nameStr);
+            // inclusions loaded from a PCH report its prefix file at
+            // depth 0 as well, only the input itself is wanted here.
+            if (!depth && clang_File_isEqual(includedFile, mainFile))
+            {
+                context->unit->includes.push_back(name);
             }
         }
     );
 
     SearchNamespaceOrUnionOrStruct(
-        builder,
+        &context,
         clang_getTranslationUnitCursor(unit)
     );
+
+    LinkFlatElements(irUnit);
 }
@@ -1,11 +1,18 @@
 #pragma once
 
+#include <string>
+#include <vector>
 #include <functional>
 #include <clang-c/Index.h>
 
-struct Builder;
+struct IrUnit;
+struct VisitStats;
 
-void VisitTranslationUnit(Builder *builder, CXTranslationUnit unit);
+void VisitTranslationUnit(
+    IrUnit *irUnit,
+    CXTranslationUnit unit,
+    std::vector<std::string> *dependencies = nullptr,
+    VisitStats *stats = nullptr);
 
 namespace internal
 {
@@ -57,13 +64,13 @@ namespace internal
     };
 }
 
-template <typename T, typename ...ARGS>
-void visitChildren(Builder *builder, CXCursor cursor, T&& handler, ARGS&& ...args)
+template <typename C, typename T, typename ...ARGS>
+void visitChildren(C *context, CXCursor cursor, T&& handler, ARGS&& ...args)
 {
     internal::Handler<CXCursor> callback(
         std::bind(
             std::forward<T>(handler),
-            builder,
+            context,
             std::placeholders::_1,
             std::forward<ARGS>(args)...)
     );
@@ -75,13 +82,13 @@ void visitChildren(Builder *builder, CXCursor cursor, T&& handler, ARGS&& ...arg
     );
 }
 
-template <typename T, typename ...ARGS>
-void visitField(Builder *builder, CXType type, T&& handler, ARGS&& ...args)
+template <typename C, typename T, typename ...ARGS>
+void visitField(C *context, CXType type, T&& handler, ARGS&& ...args)
 {
     internal::Handler<CXCursor> callback(
         std::bind(
             std::forward<T>(handler),
-            builder,
+            context,
             std::placeholders::_1,
             std::forward<ARGS>(args)...)
     );
@@ -93,13 +100,13 @@ void visitField(Builder *builder, CXType type, T&& handler, ARGS&& ...args)
     );
 }
 
-template <typename T, typename ...ARGS>
-void visitInclusion(Builder *builder, CXTranslationUnit unit, T&& handler, ARGS&& ...args)
+template <typename C, typename T, typename ...ARGS>
+void visitInclusion(C *context, CXTranslationUnit unit, T&& handler, ARGS&& ...args)
 {
     internal::Handler<uint32_t, CXFile> callback(
         std::bind(
             std::forward<T>(handler),
-            builder,
+            context,
             std::placeholders::_1,
             std::placeholders::_2,
             std::forward<ARGS>(args)...)
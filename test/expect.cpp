@@ -0,0 +1,317 @@
+// runs clcli over one input and searches its outputs for expected text.
+//
+// usage: clcli_expect <clcli> <dir> <std> <input> <check>...
+//
+//   <std>    the -s standard, or - for plain C
+//   !ARG     ARG is passed on to clcli before the input
+//   +TEXT    TEXT appears in the generated source or header
+//   -TEXT    TEXT appears in neither
+//   /REGEX   REGEX matches the generated source or header
+//   ~TEXT    TEXT appears in the diagnostics clcli printed
+//   #RECORD  every name in RECORDNames finds its column through the
+//            emitted RECORDFieldSeeds and RECORDFieldSlots
+//   @NAME    clName_NAME is the offset of NAME in the clNames pool
+//   =        a second run, e.g. from the --cache, writes the same outputs,
+//            the ~ checks then search the second run's diagnostics
+
+#include <regex>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fmt/format.h>
+
+#include "phash.h"
+
+static std::string ReadFile(const std::string& path)
+{
+    std::string contents;
+
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        return contents;
+    }
+
+    char buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    {
+        contents.append(buffer, size);
+    }
+
+    fclose(f);
+    return contents;
+}
+
+// runs clcli with its diagnostics going to logPath.
+static bool RunClcli(const std::vector<const char *>& args, const std::string& logPath, std::string *log)
+{
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        *log = "failed to fork.\n";
+        return false;
+    }
+
+    if (!pid)
+    {
+        const int fd = open(logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || dup2(fd, STDERR_FILENO) < 0)
+        {
+            _exit(127);
+        }
+
+        execv(args[0], const_cast<char **>(args.data()));
+        _exit(127);
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0)
+    {
+        *log = fmt::format("failed to wait for {}.\n", args[0]);
+        return false;
+    }
+
+    *log = ReadFile(logPath);
+    return WIFEXITED(status) && !WEXITSTATUS(status);
+}
+
+// the numbers of a generated table, empty when it is missing.
+static std::vector<uint32_t> ReadTable(const std::string& output, const std::string& name)
+{
+    std::vector<uint32_t> values;
+
+    auto pos = output.find(name + "[] = {");
+    if (pos == std::string::npos)
+    {
+        return values;
+    }
+
+    const auto end = output.find("};", pos);
+    pos = output.find('{', pos) + 1;
+
+    while (pos < end)
+    {
+        char *next = nullptr;
+        const auto value = strtoul(output.c_str() + pos, &next, 10);
+        if (next == output.c_str() + pos)
+        {
+            ++ pos;
+            continue;
+        }
+
+        values.push_back(value);
+        pos = next - output.c_str();
+    }
+
+    return values;
+}
+
+// the column names of a record in column order, from its clName table.
+static std::vector<std::string> ReadNames(const std::string& output, const std::string& record)
+{
+    static const std::string prefix = "{clName_";
+    std::vector<std::string> names;
+
+    auto pos = output.find(record + "Names[] = {");
+    if (pos == std::string::npos)
+    {
+        return names;
+    }
+
+    const auto end = output.find("};", pos);
+    while ((pos = output.find(prefix, pos)) < end)
+    {
+        pos += prefix.size();
+        const auto comma = output.find(',', pos);
+        names.push_back(output.substr(pos, comma - pos));
+    }
+
+    return names;
+}
+
+// resolves every name the way the runtime does with clFieldHash().
+static bool CheckFieldIndex(const std::string& output, const std::string& record)
+{
+    const auto names = ReadNames(output, record);
+    const auto seeds = ReadTable(output, record + "FieldSeeds");
+    const auto slots = ReadTable(output, record + "FieldSlots");
+
+    if (names.empty() || seeds.empty() || seeds.size() != slots.size())
+    {
+        return false;
+    }
+
+    const uint32_t mask = seeds.size() - 1;
+    for (size_t i = 0; i < names.size(); ++ i)
+    {
+        const auto seed = seeds[FieldHash(names[i], 0) & mask];
+        if (slots[FieldHash(names[i], seed) & mask] != i + 1)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// the clNames blob is one quoted "name\0" line per name.
+static bool CheckPooledName(const std::string& output, const std::string& name)
+{
+    auto pos = output.find("clNames[] =");
+    if (pos == std::string::npos)
+    {
+        return false;
+    }
+
+    std::string pool;
+    const auto end = output.find(';', pos);
+    while ((pos = output.find('"', pos)) < end)
+    {
+        const auto close = output.find("\\0\"", pos + 1);
+        pool += output.substr(pos + 1, close - pos - 1);
+        pool += '\0';
+        pos = close + 3;
+    }
+
+    const std::string entry = fmt::format("clName_{} = ", name);
+    pos = output.find(entry);
+    if (pos == std::string::npos)
+    {
+        return false;
+    }
+
+    const auto offset = strtoul(output.c_str() + pos + entry.size(), nullptr, 10);
+    return offset < pool.size()
+        && !pool.compare(offset, name.size() + 1, name + '\0');
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5)
+    {
+        fmt::print(stderr, "usage: {} <clcli> <dir> <std> <input> <check>...\n", argv[0]);
+        return 2;
+    }
+
+    const std::string clcli = argv[1];
+    const std::string dir = argv[2];
+    const std::string standard = argv[3];
+    const std::string input = argv[4];
+
+    if (mkdir(dir.c_str(), 0755) && errno != EEXIST)
+    {
+        fmt::print(stderr, "{}: failed to create.\n", dir);
+        return 1;
+    }
+
+    std::vector<const char *> args = {
+        clcli.c_str(),
+        "--codec",
+        "-C",
+        dir.c_str(),
+        "-n",
+        "expect",
+    };
+
+    if (standard != "-")
+    {
+        args.push_back("-s");
+        args.push_back(standard.c_str());
+    }
+
+    for (int i = 5; i < argc; ++ i)
+    {
+        if (argv[i][0] == '!')
+        {
+            args.push_back(argv[i] + 1);
+        }
+    }
+
+    args.push_back(input.c_str());
+    args.push_back(nullptr);
+
+    const std::string logPath = dir + "/clcli.log";
+    const char *extension = standard.find('+') != std::string::npos ? "cpp" : "c";
+    const std::string sourcePath = fmt::format("{}/expect.{}", dir, extension);
+
+    std::string log;
+    if (!RunClcli(args, logPath, &log))
+    {
+        fmt::print(stderr, "{}: clcli failed.\n{}", input, log);
+        return 1;
+    }
+
+    const std::string output = ReadFile(sourcePath) + ReadFile(dir + "/expect.h");
+
+    bool rerun = false;
+    for (int i = 5; i < argc; ++ i)
+    {
+        rerun = rerun || !strcmp(argv[i], "=");
+    }
+
+    std::string rerunOutput = output;
+    if (rerun)
+    {
+        if (!RunClcli(args, logPath, &log))
+        {
+            fmt::print(stderr, "{}: second clcli run failed.\n{}", input, log);
+            return 1;
+        }
+
+        rerunOutput = ReadFile(sourcePath) + ReadFile(dir + "/expect.h");
+    }
+
+    int failures = 0;
+    for (int i = 5; i < argc; ++ i)
+    {
+        const char kind = argv[i][0];
+        const std::string text = argv[i] + 1;
+
+        bool passed = false;
+        switch (kind)
+        {
+            case '+':
+                passed = output.find(text) != std::string::npos;
+                break;
+            case '-':
+                passed = output.find(text) == std::string::npos;
+                break;
+            case '/':
+                passed = std::regex_search(output, std::regex(text));
+                break;
+            case '~':
+                passed = log.find(text) != std::string::npos;
+                break;
+            case '#':
+                passed = CheckFieldIndex(output, text);
+                break;
+            case '@':
+                passed = CheckPooledName(output, text);
+                break;
+            case '=':
+                passed = text.empty() && rerunOutput == output;
+                break;
+            case '!':
+                continue;
+            default:
+                fmt::print(stderr, "{}: unknown check.\n", argv[i]);
+                return 2;
+        }
+
+        if (!passed)
+        {
+            fmt::print(stderr, "{}: check {} failed.\n", input, argv[i]);
+            ++ failures;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
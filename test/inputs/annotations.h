@@ -0,0 +1,15 @@
+#pragma once
+
+#define CLCLI(hint) __attribute__((annotate("clcli:" hint)))
+
+struct Hinted
+{
+    unsigned id CLCLI("varint");
+    int delta CLCLI("zigzag");
+    long stamp __attribute__((annotate("other:tool"))) CLCLI("fixed");
+    unsigned count;
+    int items[16] CLCLI("length=count") CLCLI("max=8");
+    double ratio CLCLI("varint");
+    unsigned mask CLCLI("zigzag");
+    int speed CLCLI("speed=fast");
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+struct Flags
+{
+    unsigned a : 3;
+    unsigned b : 5;
+    unsigned c : 24;
+    unsigned d : 4;
+    int : 0;
+    unsigned char e : 2;
+};
+
+struct __attribute__((packed)) Packed
+{
+    unsigned char tag;
+    unsigned v : 20;
+    unsigned w : 12;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+struct Request
+{
+    int id;
+    int parent_id;
+    int trace_id;
+    int span_id;
+    unsigned flags;
+    unsigned priority;
+    long deadline;
+    long created_at;
+    long updated_at;
+    double weight;
+    double score;
+    char kind;
+    char state;
+    short retries;
+    short max_retries;
+    unsigned a;
+    unsigned b;
+    unsigned c;
+    unsigned ab;
+    unsigned ba;
+};
+
+struct Single
+{
+    int value;
+};
@@ -0,0 +1,7 @@
+#include <stdio.h>
+
+struct LogSink
+{
+    int level;
+    FILE *file;
+};
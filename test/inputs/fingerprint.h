@@ -0,0 +1,13 @@
+#pragma once
+
+struct Point
+{
+    int x;
+    int y;
+};
+
+struct Segment
+{
+    struct Point from;
+    struct Point to;
+};
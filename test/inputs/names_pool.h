@@ -0,0 +1,16 @@
+#pragma once
+
+struct Rect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+struct Circle
+{
+    int x;
+    int y;
+    int radius;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+struct Sample
+{
+    int x;
+    int y;
+    int z;
+    unsigned count;
+    char tag;
+    double w;
+    double h;
+    short s;
+};
+
+struct Gapped
+{
+    char a;
+    char b;
+    int c;
+    int d;
+};
@@ -0,0 +1,7 @@
+struct impl;
+
+struct Handle
+{
+    int id;
+    struct impl *impl;
+};
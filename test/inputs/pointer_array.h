@@ -0,0 +1,9 @@
+#pragma once
+
+struct Argv
+{
+    int count;
+    char *args[4];
+    void (*handlers[2])(int);
+    int codes[2];
+};
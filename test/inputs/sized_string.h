@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stddef.h>
+
+struct Label
+{
+    size_t size;
+    char *name;
+    unsigned count;
+    int *values __attribute__((annotate("clcli:length=count")));
+};
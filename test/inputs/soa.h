@@ -0,0 +1,22 @@
+#pragma once
+
+struct Vec2
+{
+    float x;
+    float y;
+};
+
+struct Tagged
+{
+    int id;
+    unsigned flags : 2;
+};
+
+struct Mesh
+{
+    unsigned count;
+    struct Vec2 points[8];
+    struct Tagged tags[4];
+    unsigned path_len;
+    struct Vec2 path[16];
+};
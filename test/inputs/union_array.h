@@ -0,0 +1,13 @@
+#pragma once
+
+union Value
+{
+    int i;
+    float f;
+};
+
+struct Cell
+{
+    int count;
+    union Value values[2];
+};
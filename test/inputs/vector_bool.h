@@ -0,0 +1,7 @@
+#include <vector>
+
+struct Flags
+{
+    int id;
+    std::vector<bool> bits;
+};